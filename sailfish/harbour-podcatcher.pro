@@ -13,25 +13,43 @@
 TARGET = harbour-podcatcher
 
 DEFINES += PODCATCHER_VERSION=1123
-QT += sql xml concurrent
+QT += sql xml concurrent dbus
 
 CONFIG(release, debug|release):DEFINES += QT_NO_DEBUG_OUTPUT
 
 CONFIG += sailfishapp
 
 CONFIG += link_pkgconfig
-PKGCONFIG += sailfishapp mlite5
+PKGCONFIG += sailfishapp mlite5 zlib
 #PKGCONFIG += contentaction5
 
+# Optional feed transfer encodings, used when the libraries are available.
+packagesExist(libbrotlidec) {
+    PKGCONFIG += libbrotlidec
+    DEFINES += PODCATCHER_HAVE_BROTLI
+}
+packagesExist(libzstd) {
+    PKGCONFIG += libzstd
+    DEFINES += PODCATCHER_HAVE_ZSTD
+}
+
 SOURCES += src/Podcatcher.cpp \
     src/dbhelper.cpp \
     src/podcastchannel.cpp \
     src/podcastchannelsmodel.cpp \
+    src/podcastcontentdecoder.cpp \
     src/podcastepisode.cpp \
+    src/podcastepisodesfiltermodel.cpp \
     src/podcastepisodesmodel.cpp \
     src/podcastepisodesmodelfactory.cpp \
+    src/podcastimageprovider.cpp \
+    src/podcastimporter.cpp \
+    src/podcastinboxmodel.cpp \
+    src/podcastlogocache.cpp \
     src/podcastmanager.cpp \
+    src/podcastnetworkmanager.cpp \
     src/podcastrssparser.cpp \
+    src/podcastsearchmodel.cpp \
     src/podcastsqlmanager.cpp \
     src/podcatcherui.cpp
 
@@ -66,7 +84,10 @@ DISTFILES += \
     qml/pages/PodcastDownloadingProgress.qml \
     qml/pages/EpisodeDescriptionPage.qml \
     qml/pages/SearchPodcasts.qml \
+    qml/pages/SearchEpisodes.qml \
+    qml/pages/NewEpisodes.qml \
     qml/pages/ImportFromGPodder.qml \
+    qml/pages/ImportFromOPML.qml \
     qml/pages/About.qml \
     qml/pages/Settings.qml \
     harbour-podcatcher.desktop \
@@ -79,12 +100,20 @@ HEADERS += \
     src/dbhelper.h \
     src/podcastchannel.h \
     src/podcastchannelsmodel.h \
+    src/podcastcontentdecoder.h \
     src/podcastepisode.h \
+    src/podcastepisodesfiltermodel.h \
     src/podcastepisodesmodel.h \
     src/podcastepisodesmodelfactory.h \
     src/podcastglobals.h \
+    src/podcastimageprovider.h \
+    src/podcastimporter.h \
+    src/podcastinboxmodel.h \
+    src/podcastlogocache.h \
     src/podcastmanager.h \
+    src/podcastnetworkmanager.h \
     src/podcastrssparser.h \
+    src/podcastsearchmodel.h \
     src/podcastsqlmanager.h \
     src/podcasttester.h \
     src/podcatcherui.h
@@ -25,19 +25,23 @@ ApplicationWindow
 {
     id: appWindow
     signal showChannel(string id)
-    signal downloadPodcast(int channelid, int index)
-    signal playPodcast(int channelId, int index)
-    signal openWeb(int channelId, int index)
+    signal downloadPodcast(int channelid, int dbid)
+    signal playPodcast(int channelId, int dbid)
+    signal openWeb(int channelId, int dbid)
     signal refreshEpisodes(int channelId)
-    signal cancelDownload(int channelId, int index)
-    signal cancelQueue(int channelId, int index)
+    signal cancelDownload(int channelId, int dbid)
+    signal cancelQueue(int channelId, int dbid)
     signal deleteChannel(string channelId)
     signal allListened(string channelId)
-    signal deleteDownloaded(int channelId, int index)
-    signal markAsUnplayed(int channelId, int index)
-    signal startStreaming(int channelId, int index)
+    signal deleteDownloaded(int channelId, int dbid)
+    signal markAsUnplayed(int channelId, int dbid)
+    signal startStreaming(int channelId, int dbid)
     signal autoDownloadChanged(int channelId, bool autoDownload)
 
+    // Channel logos are cached in the sizes they are shown in.
+    // MainPage shows them in the list items, the channel and episode pages at 130 px.
+    Component.onCompleted: ui.setChannelLogoSizes([Theme.itemSizeLarge, 130])
+
     initialPage: Component { MainPage { } }
     cover: Qt.resolvedUrl("cover/CoverPage.qml")
     allowedOrientations:Orientation.Portrait
@@ -47,6 +47,13 @@ Page {
                 }
             }
 
+            MenuItem {
+                text: qsTr("Import podcasts from OPML")
+                onClicked: {
+                    pageStack.push(importFromOPMLComponent)
+                }
+            }
+
             MenuItem {
                 text: qsTr("Add URL manually")
                 onClicked: {
@@ -234,6 +241,13 @@ Page {
             }
         }
 
+        Component{
+            id: importFromOPMLComponent
+            ImportFromOPML{
+
+            }
+        }
+
         Component{
             id: addNewPodcastComponent
             Dialog {
@@ -55,6 +55,7 @@ Page {
                 PodcastChannelLogo{
                     id: channelLogo
                     channelLogo: channel.logo
+                    logoKey: channel.logoKey
                     anchors.left: podcastEpisodeRect.left
                     anchors.top: podcastEpisodeRect.top
                     anchors.leftMargin: Theme.horizontalPageMargin
@@ -0,0 +1,68 @@
+/**
+ * This file is part of Podcatcher for Sailfish OS.
+ * Authors: Johan Paul (johan.paul@gmail.com)
+ *          Moritz Carmesin (carolus@carmesinus.de)
+ *
+ * Podcatcher for Sailfish OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Podcatcher for Sailfish OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+import QtQuick 2.0
+import Sailfish.Silica 1.0
+
+Dialog {
+
+    canAccept: opmlFileField.text.length > 0
+
+    Column {
+        anchors.fill: parent
+        spacing: Theme.paddingMedium
+
+        DialogHeader{
+            id: header
+            title: qsTr("Import podcasts from OPML")
+            acceptText: qsTr("Import")
+        }
+
+        TextField {
+            id: opmlFileField
+            width: parent.width
+            placeholderText: "/home/nemo/Documents/podcasts.opml"
+            label: qsTr("OPML file")
+            inputMethodHints: Qt.ImhNoAutoUppercase | Qt.ImhNoPredictiveText
+
+            Keys.onReturnPressed: {
+                parent.focus = true;
+            }
+        }
+
+        Label {
+            width: parent.width - 2 * Theme.paddingLarge
+            x: Theme.paddingLarge
+            wrapMode: Text.WordWrap
+            font.pixelSize: Theme.fontSizeExtraSmall
+            color: Theme.secondaryColor
+            text: qsTr("Export the OPML file from your previous podcast client, for example to the Documents folder.")
+        }
+    }
+
+    onStatusChanged: {
+        if (status == DialogStatus.Opening) {
+            opmlFileField.text = ""
+        }
+    }
+
+    onAccepted: {
+        mainPage.opmlImport(opmlFileField.text);
+        pageStack.pop();
+    }
+}
@@ -52,6 +52,10 @@ Page {
         ui.importFromGPodder(username, password);
     }
 
+    function opmlImport(opmlFile) {
+        ui.importFromOPML(opmlFile);
+    }
+
     SilicaFlickable{
 
         //contentHeight: mainPageColumn.height
@@ -140,6 +144,7 @@ Page {
                     PodcastChannelLogo {
                         id: channelLogoId;
                         channelLogo: logo
+                        logoKey: model.logoKey
                         anchors.left: parent.left
                         anchors.verticalCenter: parent.verticalCenter
                         width: parent.height;
@@ -221,6 +226,7 @@ Page {
             target: ui
             onShowInfoBanner: {
                 fetchingChannelBanner.hide(true);
+                importingBanner.hide(true);
                 uiInfoBanner.hide(true);
                 uiInfoBanner.text = text
                 uiInfoBanner.show();
@@ -235,6 +241,14 @@ Page {
                 }
             }
 
+            onImportProgress: {
+                if (done < total) {
+                    importingBanner.text = qsTr("Importing subscriptions... %1/%2").arg(done).arg(total);
+                    importingBanner.show();
+                } else {
+                    importingBanner.hide();
+                }
+            }
 
         }
 
@@ -288,6 +302,22 @@ Page {
                 }
             }
 
+            MenuItem {
+                text: qsTr("What's new")
+                visible: podcastChannelsList.count > 0
+                onClicked: {
+                    openFile("NewEpisodes.qml");
+                }
+            }
+
+            MenuItem {
+                text: qsTr("Search episodes")
+                visible: podcastChannelsList.count > 0
+                onClicked: {
+                    openFile("SearchEpisodes.qml");
+                }
+            }
+
             MenuItem {
                 text: qsTr("Refresh all subscriptions")
                 onClicked: {
@@ -317,6 +347,11 @@ Page {
         text: qsTr("Fetching channel information...")
     }
 
+    InfoBanner {
+        id: importingBanner
+        timerEnabled: false
+    }
+
 
     ConfigurationValue{
         id: showPopularConf
@@ -0,0 +1,86 @@
+/**
+ * This file is part of Podcatcher for Sailfish OS.
+ *
+ * Podcatcher for Sailfish OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Podcatcher for Sailfish OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import QtQuick 2.0
+import Sailfish.Silica 1.0
+
+// The newest episodes of all the subscriptions, see PodcastInboxModel.
+Page {
+    id: newEpisodesPage
+
+    SilicaListView {
+        id: newEpisodesList
+        anchors.fill: parent
+        model: inboxModel
+
+        header: PageHeader {
+            title: qsTr("What's new")
+        }
+
+        ViewPlaceholder {
+            enabled: newEpisodesList.count == 0
+            text: qsTr("No new episodes")
+        }
+
+        delegate: ListItem {
+            id: episodeItem
+            contentHeight: episodeColumn.height + 2 * Theme.paddingSmall
+
+            Column {
+                id: episodeColumn
+                anchors.left: parent.left
+                anchors.right: parent.right
+                anchors.leftMargin: Theme.horizontalPageMargin
+                anchors.rightMargin: Theme.horizontalPageMargin
+                anchors.verticalCenter: parent.verticalCenter
+
+                Label {
+                    width: parent.width
+                    text: model.title
+                    truncationMode: TruncationMode.Fade
+                    color: episodeItem.highlighted ? Theme.highlightColor : Theme.primaryColor
+                }
+
+                Label {
+                    width: parent.width
+                    text: model.channelTitle + (model.published != "" ? " · " + model.published : "")
+                    truncationMode: TruncationMode.Fade
+                    font.pixelSize: Theme.fontSizeExtraSmall
+                    color: episodeItem.highlighted ? Theme.secondaryHighlightColor : Theme.secondaryColor
+                }
+
+                Label {
+                    width: parent.width
+                    text: model.descriptionPreview
+                    visible: text != ""
+                    maximumLineCount: 2
+                    wrapMode: Text.Wrap
+                    elide: Text.ElideRight
+                    font.pixelSize: Theme.fontSizeExtraSmall
+                    color: episodeItem.highlighted ? Theme.secondaryHighlightColor : Theme.secondaryColor
+                }
+            }
+
+            onClicked: {
+                appWindow.showChannel(model.channelId);
+                mainPage.openFile("PodcastEpisodes.qml");
+            }
+        }
+
+        VerticalScrollDecorator {}
+    }
+}
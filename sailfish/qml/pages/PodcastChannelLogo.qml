@@ -20,6 +20,17 @@ import QtQuick 2.0
 
 Image {
     property string channelLogo
-    source: (channelLogo.length == 0 ? "qrc:///gfx/Podcatcher_generic_podcast_cover.png" : channelLogo)
+    property string logoKey
+
+    // Cached logos come from the image provider, decoded off the render thread in the size they are shown in.
+    // Logos cached by older versions are loaded from the file, also asynchronously and scaled.
+    // Before the layout the size is 0, which would load the logo in its full size, so nothing is loaded until then.
+    source: (channelLogo.length == 0 ? "qrc:///gfx/Podcatcher_generic_podcast_cover.png"
+                                     : (Math.max(width, height) <= 0 ? ""
+                                                                     : (logoKey.length > 0 ? "image://podcatcher/" + logoKey + "/" + Math.round(Math.max(width, height))
+                                                                                           : channelLogo)))
+    sourceSize.width: (logoKey.length > 0 ? 0 : width)
+    sourceSize.height: (logoKey.length > 0 ? 0 : height)
+    asynchronous: true
     smooth: true
 }
@@ -66,8 +66,8 @@ Item {
     MouseArea {
         anchors.fill: parent
         onClicked: {
-            console.log("Cancel download of: " + channelId + "index: "+index);
-            appWindow.cancelDownload(channelId, index);
+            console.log("Cancel download of: " + channelId + " dbid: "+dbid);
+            appWindow.cancelDownload(channelId, dbid);
         }
     }
 }
@@ -36,6 +36,7 @@ Column{
         PodcastChannelLogo {
             id: channelLogo;
             channelLogo: channel.logo
+            logoKey: channel.logoKey
             width: 130
             height: 130
         }
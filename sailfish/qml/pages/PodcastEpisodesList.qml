@@ -18,6 +18,7 @@
  */
 import QtQuick 2.0
 import Sailfish.Silica 1.0
+import harbour.podcatcher 1.0
 
 
 Item {
@@ -27,44 +28,6 @@ Item {
 
     property int channelId
 
-    function downloadingStatusText(alreadyDownloadedSize, totalDownloadSize) {
-        var downloadedStatus = parseInt(alreadyDownloadedSize) / 1024;  // to kB
-        var totalDownloadStatus = parseInt(totalDownloadSize) / 1024;   // to kB
-
-        var downloaded_mbs = Math.round(downloadedStatus / 1024);  // 1MB = 1024kB
-        var total_mbs = Math.round(totalDownloadStatus / 1024); // 1MB = 1024kB
-
-        var currSize;
-
-        if (downloaded_mbs == 0) {
-            currSize = Math.round(downloadedStatus % 1024) + " kB";
-        } else {
-            currSize = (downloadedStatus / 1024).toFixed(1) + " MB";
-        }
-
-        var total;
-        var totalSize;
-
-        if (total_mbs == 0) {
-            total = Math.round(totalDownloadStatus % 1024);
-            if (total > 0 ) {
-                totalSize =  total + " kB";
-            }
-        } else {
-            total = Math.round(totalDownloadStatus / 1024);
-            if (total > 0 ) {
-                totalSize =  total + " MB";
-            }
-        }
-
-        var download_statusText=qsTr("Downloaded %1 of total %2.");
-
-        download_statusText = download_statusText.arg(currSize);
-        download_statusText = download_statusText.arg(totalSize);
-
-        return download_statusText;
-    }
-
     Rectangle {
         id: podcastEpisodesInfoRect
 
@@ -76,13 +39,35 @@ Item {
         SilicaListView {
             id: podcastEpisodesList
             anchors.fill: podcastEpisodesInfoRect
-            model: episodesModel
+            model: episodesFilterModel
             clip: true
             anchors.top:  podcastEpisodesInfoRect.top
 
+            header: Column {
+                width: podcastEpisodesList.width
+
+                SearchField {
+                    width: parent.width
+                    placeholderText: qsTr("Search episodes")
+                    onTextChanged: episodesFilterModel.searchText = text
+                }
+
+                // The items are in the order of PodcastEpisodesFilterModel::EpisodeFilter.
+                ComboBox {
+                    width: parent.width
+                    label: qsTr("Show")
+                    menu: ContextMenu {
+                        MenuItem { text: qsTr("All episodes") }
+                        MenuItem { text: qsTr("Unplayed") }
+                        MenuItem { text: qsTr("Downloaded") }
+                        MenuItem { text: qsTr("No media") }
+                    }
+                    onCurrentIndexChanged: episodesFilterModel.filter = currentIndex
+                }
+            }
+
             delegate: ListItem {
                 id: podcastItem
-                state: episodeState
                 contentHeight: episodeName.height + lastPlayed.height + Theme.paddingSmall + Theme.paddingMedium
                 width: parent.width
 
@@ -99,31 +84,31 @@ Item {
                 }
 
                 menu: ContextMenu{
-                    visible: (episodeState == "downloaded" || episodeState == "played" || episodeState == "get")
+                    visible: (episodeStatus === Episode.DownloadedStatus || episodeStatus === Episode.PlayedStatus || episodeStatus === Episode.GetStatus)
                     MenuItem {
                         text: qsTr("Delete downloaded podcast")
-                        visible: (episodeState == "downloaded" || episodeState == "played");
+                        visible: (episodeStatus === Episode.DownloadedStatus || episodeStatus === Episode.PlayedStatus);
                         onClicked: {
                             episodeRemorse.execute(podcastItem,qsTr("Deleting"),
                                                    function(){
-                                                       console.log("Emiting deleteDownloaded() "+ channelId + index);
-                                                       appWindow.deleteDownloaded(channelId, index);
+                                                       console.log("Emiting deleteDownloaded() "+ channelId + dbid);
+                                                       appWindow.deleteDownloaded(channelId, dbid);
                                                    });
                         }
                     }
                     MenuItem{
                         text: qsTr("Mark as unplayed")
-                        visible: episodeState == "played"
+                        visible: episodeStatus === Episode.PlayedStatus
                         onClicked: {
-                            appWindow.markAsUnplayed(channelId,index);
+                            appWindow.markAsUnplayed(channelId, dbid);
                         }
                     }
 
                     MenuItem {
                         text: qsTr("Start streaming the podcast")
-                        visible: (episodeState == "get")
+                        visible: (episodeStatus === Episode.GetStatus)
                         onClicked: {
-                            appWindow.startStreaming(channelId, index);
+                            appWindow.startStreaming(channelId, dbid);
                         }
 
                     }
@@ -230,7 +215,7 @@ Item {
                     }
                     font.pixelSize: Theme.fontSizeTiny
                     color: podcastItem.highlighted ? Theme.secondaryHighlightColor : Theme.secondaryColor
-                    text: downloadingStatusText(alreadyDownloadedSize, totalDownloadSize);
+                    text: downloadStatusText
                     height: Text.paintedHeight
                     visible: false;
                 }
@@ -247,7 +232,7 @@ Item {
                     visible: true
 
                     onClicked: {
-                        appWindow.downloadPodcast(channelId, index);  // Channel id = which model to use, index = row in the model.
+                        appWindow.downloadPodcast(channelId, dbid);  // Channel id = which model to use, dbid = the episode in the model.
                     }
                 }
 
@@ -261,8 +246,8 @@ Item {
                     visible: false
 
                     onClicked: {
-                        console.log("Cancel queue of: " + channelId + " index: "+index);
-                        appWindow.cancelQueue(channelId, index);
+                        console.log("Cancel queue of: " + channelId + " dbid: "+dbid);
+                        appWindow.cancelQueue(channelId, dbid);
                     }
                 }
 
@@ -276,8 +261,8 @@ Item {
                     visible: false
 
                     onClicked: {
-                        console.log("Cancel download of: " + channelId + "index: "+index);
-                        appWindow.cancelDownload(channelId, index);
+                        console.log("Cancel download of: " + channelId + " dbid: "+dbid);
+                        appWindow.cancelDownload(channelId, dbid);
                     }
                 }
 
@@ -291,7 +276,7 @@ Item {
                     visible: false
 
                     onClicked: {
-                        appWindow.playPodcast(channelId, index);  // Channel id = which model to use, index = row in the model.
+                        appWindow.playPodcast(channelId, dbid);  // Channel id = which model to use, dbid = the episode in the model.
                     }
                 }
 
@@ -305,7 +290,7 @@ Item {
                     visible: false
 
                     onClicked: {
-                        appWindow.openWeb(channelId, index);  // Channel id = which model to use, index = row in the model.
+                        appWindow.openWeb(channelId, dbid);  // Channel id = which model to use, dbid = the episode in the model.
                     }
                 }
 
@@ -334,6 +319,7 @@ Item {
                 states: [
                     State {
                         name: "get"
+                        when: episodeStatus === Episode.GetStatus
                         PropertyChanges {
                             target: downloadButton
                             visible: true
@@ -349,6 +335,7 @@ Item {
                     },
                     State {
                         name: "queued"
+                        when: episodeStatus === Episode.QueuedStatus
                         PropertyChanges {
                             target: downloadButton
                             visible: false
@@ -369,6 +356,7 @@ Item {
                     },
                     State {
                         name: "downloading"
+                        when: episodeStatus === Episode.DownloadingStatus
                         PropertyChanges {
                             target: queueButton
                             visible: false
@@ -396,6 +384,7 @@ Item {
                     },
                     State {
                         name: "downloaded"
+                        when: episodeStatus === Episode.DownloadedStatus
                         PropertyChanges {
                             target: cancelButton
                             visible: false
@@ -423,6 +412,7 @@ Item {
                     },
                     State {
                         name: "played"
+                        when: episodeStatus === Episode.PlayedStatus
                         PropertyChanges {
                             target: downloadedIndicator
                             visible: true
@@ -444,6 +434,7 @@ Item {
                     },
                     State {
                         name: "undownloadable"
+                        when: episodeStatus === Episode.UndownloadableStatus
                         PropertyChanges {
                             target: downloadButton
                             visible: false
@@ -0,0 +1,102 @@
+/**
+ * This file is part of Podcatcher for Sailfish OS.
+ *
+ * Podcatcher for Sailfish OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Podcatcher for Sailfish OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import QtQuick 2.0
+import Sailfish.Silica 1.0
+
+// Searches the episodes of the subscriptions, see PodcastSearchModel.
+Page {
+    id: searchEpisodesPage
+
+    SilicaListView {
+        id: searchResultsList
+        anchors.fill: parent
+        model: searchModel
+
+        header: Column {
+            width: searchResultsList.width
+
+            PageHeader {
+                title: qsTr("Search episodes")
+            }
+
+            SearchField {
+                id: searchWord
+                width: parent.width
+                placeholderText: qsTr("Title or description")
+                text: searchModel.searchText
+
+                onTextChanged: searchModel.search(text)
+                Keys.onReturnPressed: searchResultsList.focus = true
+
+                Component.onCompleted: searchWord.forceActiveFocus()
+            }
+        }
+
+        ViewPlaceholder {
+            enabled: searchResultsList.count == 0 && searchModel.searchText != ""
+            text: qsTr("No episodes found.")
+        }
+
+        delegate: ListItem {
+            id: resultItem
+            contentHeight: resultColumn.height + 2 * Theme.paddingSmall
+
+            Column {
+                id: resultColumn
+                anchors.left: parent.left
+                anchors.right: parent.right
+                anchors.leftMargin: Theme.horizontalPageMargin
+                anchors.rightMargin: Theme.horizontalPageMargin
+                anchors.verticalCenter: parent.verticalCenter
+
+                Label {
+                    width: parent.width
+                    text: model.title
+                    truncationMode: TruncationMode.Fade
+                    color: resultItem.highlighted ? Theme.highlightColor : Theme.primaryColor
+                }
+
+                Label {
+                    width: parent.width
+                    text: model.channelTitle + (model.published != "" ? " · " + model.published : "")
+                    truncationMode: TruncationMode.Fade
+                    font.pixelSize: Theme.fontSizeExtraSmall
+                    color: resultItem.highlighted ? Theme.secondaryHighlightColor : Theme.secondaryColor
+                }
+
+                Label {
+                    width: parent.width
+                    text: model.descriptionPreview
+                    visible: text != ""
+                    maximumLineCount: 2
+                    wrapMode: Text.Wrap
+                    elide: Text.ElideRight
+                    font.pixelSize: Theme.fontSizeExtraSmall
+                    color: resultItem.highlighted ? Theme.secondaryHighlightColor : Theme.secondaryColor
+                }
+            }
+
+            onClicked: {
+                appWindow.showChannel(model.channelId);
+                mainPage.openFile("PodcastEpisodes.qml");
+            }
+        }
+
+        VerticalScrollDecorator {}
+    }
+}
@@ -39,6 +39,13 @@ Page {
                 }
             }
 
+            MenuItem {
+                text: qsTr("Import podcasts from OPML")
+                onClicked: {
+                    pageStack.push(importFromOPMLComponent)
+                }
+            }
+
             MenuItem {
                 text: qsTr("Add URL manually")
                 onClicked: {
@@ -231,6 +238,13 @@ Page {
         }
     }
 
+    Component{
+        id: importFromOPMLComponent
+        ImportFromOPML{
+
+        }
+    }
+
     Component{
         id: addNewPodcastComponent
         Dialog {
@@ -3,6 +3,8 @@
 
 #include <sailfishapp.h>
 #include "podcatcherui.h"
+#include "podcastepisode.h"
+#include "podcasttester.h"
 
 int main(int argc, char *argv[])
 {
@@ -17,6 +19,21 @@ int main(int argc, char *argv[])
 
     QGuiApplication* app = SailfishApp::application(argc,argv);
 
+    // "harbour-podcatcher --test" runs the offline tests and the benchmarks
+    // instead of the UI, and fails if a test fails.
+    if (app->arguments().contains("--test")) {
+        PodcastTester tester;
+        bool testsOk = tester.testContentDecoding();
+        testsOk = tester.testQueryPlans() && testsOk;
+        tester.benchmarkSearch();
+        tester.benchmarkEpisodeInserts();
+        return testsOk ? 0 : 1;
+    }
+
+    // For the episode status values in QML.
+    qmlRegisterUncreatableType<PodcastEpisode>("harbour.podcatcher", 1, 0, "Episode",
+                                               "Episodes are created by the episode models.");
+
     PodcatcherUI* ui = new PodcatcherUI();
 
 
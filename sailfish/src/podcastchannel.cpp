@@ -18,6 +18,7 @@
 #include <QtDebug>
 
 #include "podcastchannel.h"
+#include "podcastlogocache.h"
 
 PodcastChannel::PodcastChannel(QObject *parent) :
     QObject(parent)
@@ -26,6 +27,9 @@ PodcastChannel::PodcastChannel(QObject *parent) :
     m_isDownloading = false;
     m_autoDownloadOn = false;
     m_unplayedEpisodes = 0;
+    m_downloadedEpisodes = 0;
+    m_totalEpisodes = 0;
+    m_id = 0;
 }
 
 void PodcastChannel::setId(int id)
@@ -70,7 +74,10 @@ void PodcastChannel::setUrl(const QString &url)
 
 void PodcastChannel::setLogo(const QString &logo)
 {
-    m_logo = logo;
+    if (m_logo != logo) {
+        m_logo = logo;
+        emit channelChanged();
+    }
 }
 
 QString PodcastChannel::logo() const
@@ -78,6 +85,11 @@ QString PodcastChannel::logo() const
     return m_logo;
 }
 
+QString PodcastChannel::logoKey() const
+{
+    return PodcastLogoCache::logoKeyFromPath(m_logo);
+}
+
 void PodcastChannel::dumpInfo() const
 {
     qDebug() << "Channel info: "
@@ -141,6 +153,35 @@ void PodcastChannel::setUnplayedEpisodes(int unplayed)
     }
 }
 
+int PodcastChannel::downloadedEpisodes() const
+{
+    return m_downloadedEpisodes;
+}
+
+int PodcastChannel::totalEpisodes() const
+{
+    return m_totalEpisodes;
+}
+
+void PodcastChannel::setEpisodeCounters(int unplayed, int downloaded, int total)
+{
+    if (unplayed != m_unplayedEpisodes ||
+        downloaded != m_downloadedEpisodes ||
+        total != m_totalEpisodes) {
+        m_unplayedEpisodes = unplayed;
+        m_downloadedEpisodes = downloaded;
+        m_totalEpisodes = total;
+        emit channelChanged();
+    }
+}
+
+void PodcastChannel::updateEpisodeCounters(int unplayedDelta, int downloadedDelta, int totalDelta)
+{
+    setEpisodeCounters(m_unplayedEpisodes + unplayedDelta,
+                       m_downloadedEpisodes + downloadedDelta,
+                       m_totalEpisodes + totalDelta);
+}
+
 void PodcastChannel::setIsDownloading(bool downloading)
 {
     if (downloading != m_isDownloading) {
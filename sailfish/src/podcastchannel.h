@@ -29,7 +29,8 @@ class PodcastChannel : public QObject
 {
     Q_OBJECT
     Q_PROPERTY(int channelId READ channelDbId WRITE setId)
-    Q_PROPERTY(QString logo READ logo WRITE setLogo)
+    Q_PROPERTY(QString logo READ logo WRITE setLogo NOTIFY channelChanged)
+    Q_PROPERTY(QString logoKey READ logoKey NOTIFY channelChanged)
     Q_PROPERTY(QString title READ title WRITE setTitle)
     Q_PROPERTY(QString description READ description WRITE setDescription)
     Q_PROPERTY(bool isRefreshing READ isRefreshing WRITE setIsRefreshing)
@@ -49,6 +50,8 @@ public:
     void setIsRefreshing(bool refreshing);
     void setIsDownloading(bool downloading);
     void setUnplayedEpisodes(int unplayed);
+    void setEpisodeCounters(int unplayed, int downloaded, int total);
+    void updateEpisodeCounters(int unplayedDelta, int downloadedDelta, int totalDelta);
     void setAutoDownloadOn(bool autoDownloadOn);
 
     void setXml(QByteArray xml);
@@ -58,11 +61,14 @@ public:
     QString title() const;
     QString logoUrl() const;
     QString logo() const;
+    QString logoKey() const;
     QString url() const;
     QString description() const;
     bool isRefreshing() const;
     bool isDownloading() const;
     int unplayedEpisodes() const;
+    int downloadedEpisodes() const;
+    int totalEpisodes() const;
     bool isAutoDownloadOn() const;
 
 
@@ -92,6 +98,8 @@ private:
     bool m_isRefreshing;
     bool m_isDownloading;
     int m_unplayedEpisodes;
+    int m_downloadedEpisodes;
+    int m_totalEpisodes;
     bool m_autoDownloadOn;
 
     QByteArray m_xml;
@@ -15,6 +15,7 @@
  * You should have received a copy of the GNU General Public License
  * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <QtAlgorithms>
 #include <QtDebug>
 
 #include "podcastchannelsmodel.h"
@@ -27,10 +28,13 @@ PodcastChannelsModel::PodcastChannelsModel(QObject *parent) :
     m_roles[TitleRole] = "title";
     m_roles[DescriptionRole] = "description";
     m_roles[LogoRole] = "logo";
+    m_roles[LogoKeyRole] = "logoKey";
     m_roles[IsRefreshingRole] = "isRefreshing";
     m_roles[IsDownloadingRole] = "isDownloading";
     m_roles[UnplayedEpisodesRole] = "unplayedEpisodes";
     m_roles[AutoDownloadOnRole] = "autoDownloadOn";
+    m_roles[DownloadedEpisodesRole] = "downloadedEpisodes";
+    m_roles[TotalEpisodesRole] = "totalEpisodes";
 
     //setRoleNames(roles);
 
@@ -43,7 +47,11 @@ PodcastChannelsModel::PodcastChannelsModel(QObject *parent) :
                 this, SLOT(onChannelChanged()));
 
         m_channels << channel;
+        m_channelsById.insert(channel->channelDbId(), channel);
     }
+
+    connect(m_sqlmanager, SIGNAL(episodeCountersChanged(int,int,int,int)),
+            this, SLOT(onEpisodeCountersChanged(int,int,int,int)));
 }
 
 PodcastChannelsModel::~PodcastChannelsModel() {
@@ -54,7 +62,7 @@ PodcastChannelsModel::~PodcastChannelsModel() {
 
 QVariant PodcastChannelsModel::data(const QModelIndex &index, int role) const
 {
-    if (index.row() < 0 || index.row() > m_channels.count())
+    if (index.row() < 0 || index.row() >= m_channels.count())
         return QVariant();
 
     PodcastChannel *channel = m_channels.at(index.row());
@@ -76,6 +84,10 @@ QVariant PodcastChannelsModel::data(const QModelIndex &index, int role) const
         return channel->logo();
         break;
 
+    case LogoKeyRole:
+        return channel->logoKey();
+        break;
+
     case IsRefreshingRole:
         return channel->isRefreshing();
         break;
@@ -91,6 +103,14 @@ QVariant PodcastChannelsModel::data(const QModelIndex &index, int role) const
     case AutoDownloadOnRole:
         return channel->isAutoDownloadOn();
         break;
+
+    case DownloadedEpisodesRole:
+        return channel->downloadedEpisodes();
+        break;
+
+    case TotalEpisodesRole:
+        return channel->totalEpisodes();
+        break;
     }
 
     return QVariant();
@@ -109,14 +129,13 @@ bool channelsLessThan(const PodcastChannel *c1, const PodcastChannel *c2)
 bool PodcastChannelsModel::addChannel(PodcastChannel *channel)
 {
      if (m_sqlmanager->podcastChannelToDB(channel) > 0) {
-         m_channels.append(channel);
-
-         qSort(m_channels.begin(),
-               m_channels.end(),
-               channelsLessThan);
-
-         int index = m_channels.indexOf(channel);
+         // The channels are sorted, so the new one goes after the channels
+         // with a title less than or equal to its title.
+         int index = qUpperBound(m_channels.begin(), m_channels.end(),
+                                 channel, channelsLessThan) - m_channels.begin();
          beginInsertRows(QModelIndex(), index, index);
+         m_channels.insert(index, channel);
+         m_channelsById.insert(channel->channelDbId(), channel);
          endInsertRows();
 
          connect(channel, SIGNAL(channelChanged()),
@@ -128,6 +147,31 @@ bool PodcastChannelsModel::addChannel(PodcastChannel *channel)
      }
 }
 
+// Channels that are already saved to the DB by the importer. The whole batch is
+// added with one model reset instead of sorting and inserting them one by one.
+void PodcastChannelsModel::addImportedChannels(QList<PodcastChannel *> channels)
+{
+    if (channels.isEmpty()) {
+        return;
+    }
+
+    beginResetModel();
+
+    foreach(PodcastChannel *channel, channels) {
+        m_channels.append(channel);
+        m_channelsById.insert(channel->channelDbId(), channel);
+
+        connect(channel, SIGNAL(channelChanged()),
+                this, SLOT(onChannelChanged()));
+    }
+
+    qSort(m_channels.begin(),
+          m_channels.end(),
+          channelsLessThan);
+
+    endResetModel();
+}
+
 bool PodcastChannelsModel::removeChannel(PodcastChannel *channel)
 {
     if (channel == NULL) {
@@ -138,6 +182,7 @@ bool PodcastChannelsModel::removeChannel(PodcastChannel *channel)
     int dbid = channel->channelDbId();
     // Remove from DB
     m_sqlmanager->removeChannelFromDB(dbid);
+    m_channelsById.remove(dbid);
 
     // Remove from model
     for (int i=0; i<m_channels.size(); i++) {
@@ -166,24 +211,18 @@ bool PodcastChannelsModel::channelAlreadyExists(PodcastChannel *channel)
 
 PodcastChannel * PodcastChannelsModel::podcastChannelById(int id)
 {
-    foreach(PodcastChannel *channel, m_channels) {
-        if (channel->channelDbId() == id) {
-            return channel;
-        }
-    }
-
-    return 0;
+    return m_channelsById.value(id, 0);
 }
 
-void PodcastChannelsModel::refreshChannel(int id)
+void PodcastChannelsModel::onEpisodeCountersChanged(int channelId, int unplayedDelta, int downloadedDelta, int totalDelta)
 {
-    PodcastChannel *channel = podcastChannelById(id);
+    // Channels that are being removed are not in the model anymore.
+    PodcastChannel *channel = podcastChannelById(channelId);
     if (channel == 0) {
-        qWarning() << "Could not refresh PodcastChannel. Got NULL!";
         return;
     }
 
-    m_sqlmanager->channelInDB(channel->channelDbId(), channel);
+    channel->updateEpisodeCounters(unplayedDelta, downloadedDelta, totalDelta);
 }
 
 
@@ -19,6 +19,7 @@
 #define PODCASTCHANNELSMODEL_H
 
 #include <QAbstractListModel>
+#include <QHash>
 
 #include "podcastchannel.h"
 #include "podcastsqlmanager.h"
@@ -33,10 +34,13 @@ class PodcastChannelsModel : public QAbstractListModel
         TitleRole,
         DescriptionRole,
         LogoRole,
+        LogoKeyRole,
         IsRefreshingRole,
         IsDownloadingRole,
         UnplayedEpisodesRole,
-        AutoDownloadOnRole
+        AutoDownloadOnRole,
+        DownloadedEpisodesRole,
+        TotalEpisodesRole
     };
 
 public:
@@ -46,12 +50,12 @@ public:
     QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
 
     bool addChannel(PodcastChannel *channel);
+    void addImportedChannels(QList<PodcastChannel *> channels);
     bool removeChannel(PodcastChannel *channel);
     QList<PodcastChannel *> channels();
 
     PodcastChannel * podcastChannelById(int id);
     bool channelAlreadyExists(PodcastChannel *channel);
-    void refreshChannel(int id);
     void setAutoDownloadToDB(bool autoDownload);
     void updateChannel(PodcastChannel *channel);
     QHash<int, QByteArray> roleNames() const;
@@ -62,10 +66,12 @@ public slots:
 
 private slots:
     void onChannelChanged();
+    void onEpisodeCountersChanged(int channelId, int unplayedDelta, int downloadedDelta, int totalDelta);
 
 private:
     explicit PodcastChannelsModel(QObject *parent = 0);  // Do not let instantiation of this class...
-    QList<PodcastChannel *> m_channels;
+    QList<PodcastChannel *> m_channels;             // Sorted by title.
+    QHash<int, PodcastChannel *> m_channelsById;
     PodcastSQLManager *m_sqlmanager;
     QHash<int, QByteArray> m_roles;
 
@@ -0,0 +1,305 @@
+/**
+ * This file is part of Podcatcher for Sailfish OS.
+ * Author: Johan Paul (johan.paul@gmail.com)
+ *
+ * Podcatcher for Sailfish OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Podcatcher for Sailfish OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <QtDebug>
+
+#include <zlib.h>
+
+#ifdef PODCATCHER_HAVE_BROTLI
+#include <brotli/decode.h>
+#endif
+
+#ifdef PODCATCHER_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "podcastcontentdecoder.h"
+
+static const int DECODE_CHUNK_SIZE = 16 * 1024;
+
+PodcastContentDecoder::PodcastContentDecoder(const QByteArray &contentEncoding) :
+    m_encoding(UnsupportedEncoding),
+    m_error(false),
+    m_finished(false),
+    m_gotOutput(false),
+    m_triedRawDeflate(false),
+    m_stream(0)
+{
+    QByteArray encoding = contentEncoding.trimmed().toLower();
+
+    if (encoding.isEmpty() || encoding == "identity") {
+        m_encoding = IdentityEncoding;
+    } else if (encoding == "gzip" || encoding == "x-gzip" || encoding == "deflate") {
+        m_encoding = DeflateEncoding;
+        m_error = !startInflate(false);
+#ifdef PODCATCHER_HAVE_BROTLI
+    } else if (encoding == "br") {
+        m_encoding = BrotliEncoding;
+        m_stream = BrotliDecoderCreateInstance(0, 0, 0);
+        m_error = (m_stream == 0);
+#endif
+#ifdef PODCATCHER_HAVE_ZSTD
+    } else if (encoding == "zstd") {
+        m_encoding = ZstdEncoding;
+        m_stream = ZSTD_createDStream();
+        m_error = (m_stream == 0 || ZSTD_isError(ZSTD_initDStream(static_cast<ZSTD_DStream *>(m_stream))));
+#endif
+    } else {
+        qWarning() << "Unsupported content encoding:" << contentEncoding;
+        m_error = true;
+    }
+}
+
+PodcastContentDecoder::~PodcastContentDecoder()
+{
+    endDecoder();
+}
+
+QByteArray PodcastContentDecoder::acceptEncoding()
+{
+    QByteArray accept("gzip, deflate");
+#ifdef PODCATCHER_HAVE_BROTLI
+    accept.append(", br");
+#endif
+#ifdef PODCATCHER_HAVE_ZSTD
+    accept.append(", zstd");
+#endif
+    return accept;
+}
+
+PodcastContentDecoder::Encoding PodcastContentDecoder::encoding() const
+{
+    return m_encoding;
+}
+
+bool PodcastContentDecoder::hasError() const
+{
+    return m_error;
+}
+
+bool PodcastContentDecoder::decode(const QByteArray &input, QByteArray *output)
+{
+    if (m_error) {
+        return false;
+    }
+
+    if (input.isEmpty()) {
+        return true;
+    }
+
+    if (m_finished && m_encoding != DeflateEncoding) {
+        qWarning() << "Got data after the end of the compressed stream. Ignoring it.";
+        return true;
+    }
+
+    char buffer[DECODE_CHUNK_SIZE];
+
+    switch(m_encoding) {
+    case IdentityEncoding:
+        output->append(input);
+        return true;
+
+    case DeflateEncoding:
+        return inflateData(input, output);
+
+#ifdef PODCATCHER_HAVE_BROTLI
+    case BrotliEncoding: {
+        BrotliDecoderState *state = static_cast<BrotliDecoderState *>(m_stream);
+        size_t availableIn = input.size();
+        const uint8_t *nextIn = reinterpret_cast<const uint8_t *>(input.constData());
+
+        BrotliDecoderResult result = BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT;
+        while (result == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT ||
+               (result == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT && availableIn > 0)) {
+            size_t availableOut = sizeof(buffer);
+            uint8_t *nextOut = reinterpret_cast<uint8_t *>(buffer);
+            result = BrotliDecoderDecompressStream(state, &availableIn, &nextIn,
+                                                   &availableOut, &nextOut, 0);
+            output->append(buffer, sizeof(buffer) - availableOut);
+        }
+
+        if (result == BROTLI_DECODER_RESULT_ERROR) {
+            qWarning() << "Brotli decoding error:" << BrotliDecoderErrorString(BrotliDecoderGetErrorCode(state));
+            m_error = true;
+            return false;
+        }
+
+        m_finished = (result == BROTLI_DECODER_RESULT_SUCCESS);
+        return true;
+    }
+#endif
+
+#ifdef PODCATCHER_HAVE_ZSTD
+    case ZstdEncoding: {
+        ZSTD_DStream *stream = static_cast<ZSTD_DStream *>(m_stream);
+        ZSTD_inBuffer in = { input.constData(), static_cast<size_t>(input.size()), 0 };
+
+        while (in.pos < in.size) {
+            ZSTD_outBuffer out = { buffer, sizeof(buffer), 0 };
+            size_t result = ZSTD_decompressStream(stream, &out, &in);
+            if (ZSTD_isError(result)) {
+                qWarning() << "zstd decoding error:" << ZSTD_getErrorName(result);
+                m_error = true;
+                return false;
+            }
+            output->append(buffer, out.pos);
+            m_finished = (result == 0);
+        }
+        return true;
+    }
+#endif
+
+    default:
+        m_error = true;
+        return false;
+    }
+}
+
+bool PodcastContentDecoder::finish()
+{
+    if (m_error) {
+        return false;
+    }
+
+    if (m_encoding != IdentityEncoding && !m_finished) {
+        qWarning() << "Compressed stream ended prematurely.";
+        m_error = true;
+        return false;
+    }
+
+    return true;
+}
+
+bool PodcastContentDecoder::inflateData(const QByteArray &input, QByteArray *output)
+{
+    z_stream *stream = static_cast<z_stream *>(m_stream);
+    char buffer[DECODE_CHUNK_SIZE];
+
+    if (!m_gotOutput && !m_triedRawDeflate) {
+        // Keep the start of the stream until we know which kind of deflate it is.
+        m_head.append(input);
+    }
+
+    stream->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.constData()));
+    stream->avail_in = input.size();
+
+    while (stream->avail_in > 0) {
+        if (m_finished) {
+            if (*stream->next_in != 0x1f) {
+                // Some servers pad the body after the end of the stream. Ignore it.
+                return true;
+            }
+
+            // Concatenated gzip members. Continue with the next one.
+            inflateReset(stream);
+            m_finished = false;
+        }
+
+        stream->next_out = reinterpret_cast<Bytef *>(buffer);
+        stream->avail_out = sizeof(buffer);
+
+        int result = inflate(stream, Z_NO_FLUSH);
+
+        if (result == Z_DATA_ERROR && !m_gotOutput && !m_triedRawDeflate) {
+            // Some servers send "deflate" without the zlib header. Try once more as raw deflate.
+            qDebug() << "Not a zlib stream. Trying raw deflate.";
+            m_triedRawDeflate = true;
+            endDecoder();
+            if (!startInflate(true)) {
+                m_error = true;
+                return false;
+            }
+
+            QByteArray head = m_head;
+            m_head.clear();
+            return inflateData(head, output);
+        }
+
+        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+            qWarning() << "zlib decoding error:" << result << (stream->msg ? stream->msg : "");
+            m_error = true;
+            return false;
+        }
+
+        int decoded = sizeof(buffer) - stream->avail_out;
+        if (decoded > 0) {
+            output->append(buffer, decoded);
+            if (!m_gotOutput) {
+                m_gotOutput = true;
+                m_head.clear();
+            }
+        }
+
+        if (result == Z_STREAM_END) {
+            m_finished = true;
+        } else if (result == Z_BUF_ERROR) {
+            break;      // No progress possible. Need more input.
+        }
+    }
+
+    return true;
+}
+
+bool PodcastContentDecoder::startInflate(bool rawDeflate)
+{
+    z_stream *stream = new z_stream;
+    stream->zalloc = Z_NULL;
+    stream->zfree = Z_NULL;
+    stream->opaque = Z_NULL;
+    stream->next_in = Z_NULL;
+    stream->avail_in = 0;
+
+    // 15 + 32: zlib or gzip header, detected automatically. -15: raw deflate.
+    if (inflateInit2(stream, rawDeflate ? -MAX_WBITS : MAX_WBITS + 32) != Z_OK) {
+        qWarning() << "Could not initialize zlib.";
+        delete stream;
+        return false;
+    }
+
+    m_stream = stream;
+    return true;
+}
+
+void PodcastContentDecoder::endDecoder()
+{
+    if (m_stream == 0) {
+        return;
+    }
+
+    switch(m_encoding) {
+    case DeflateEncoding: {
+        z_stream *stream = static_cast<z_stream *>(m_stream);
+        inflateEnd(stream);
+        delete stream;
+        break;
+    }
+#ifdef PODCATCHER_HAVE_BROTLI
+    case BrotliEncoding:
+        BrotliDecoderDestroyInstance(static_cast<BrotliDecoderState *>(m_stream));
+        break;
+#endif
+#ifdef PODCATCHER_HAVE_ZSTD
+    case ZstdEncoding:
+        ZSTD_freeDStream(static_cast<ZSTD_DStream *>(m_stream));
+        break;
+#endif
+    default:
+        break;
+    }
+
+    m_stream = 0;
+}
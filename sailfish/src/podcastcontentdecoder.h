@@ -0,0 +1,72 @@
+/**
+ * This file is part of Podcatcher for Sailfish OS.
+ * Author: Johan Paul (johan.paul@gmail.com)
+ *
+ * Podcatcher for Sailfish OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Podcatcher for Sailfish OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PODCASTCONTENTDECODER_H
+#define PODCASTCONTENTDECODER_H
+
+#include <QByteArray>
+
+/**
+ * Streaming decoder for a HTTP Content-Encoding. Feed the compressed body to
+ * decode() as it arrives from the network and the decoded bytes are appended
+ * to the output, so the whole compressed body never needs to be buffered.
+ *
+ * gzip and deflate are always supported. br and zstd are supported when
+ * Podcatcher is built with PODCATCHER_HAVE_BROTLI or PODCATCHER_HAVE_ZSTD.
+ */
+class PodcastContentDecoder
+{
+public:
+    enum Encoding {
+        IdentityEncoding = 0,
+        DeflateEncoding,            // Both gzip and deflate, zlib detects the header.
+        BrotliEncoding,
+        ZstdEncoding,
+        UnsupportedEncoding
+    };
+
+    explicit PodcastContentDecoder(const QByteArray &contentEncoding);
+    ~PodcastContentDecoder();
+
+    // Value for the Accept-Encoding request header.
+    static QByteArray acceptEncoding();
+
+    Encoding encoding() const;
+    bool hasError() const;
+
+    bool decode(const QByteArray &input, QByteArray *output);
+    bool finish();
+
+private:
+    bool inflateData(const QByteArray &input, QByteArray *output);
+    bool startInflate(bool rawDeflate);
+    void endDecoder();
+
+    // Disable copying.
+    PodcastContentDecoder(PodcastContentDecoder const&);      // Don't Implement
+    void operator=(PodcastContentDecoder const&);              // Don't implement
+
+    Encoding m_encoding;
+    bool m_error;
+    bool m_finished;
+    bool m_gotOutput;
+    bool m_triedRawDeflate;
+    QByteArray m_head;
+    void *m_stream;
+};
+
+#endif // PODCASTCONTENTDECODER_H
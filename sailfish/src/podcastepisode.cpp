@@ -18,55 +18,215 @@
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QDir>
+#include <QRegExp>
 #include <QVariant>
 
 #include <QtDebug>
 
+#include <MGConfItem>
+
 #include "podcastglobals.h"
 #include "podcastepisode.h"
 #include "podcastmanager.h"
+#include "podcastnetworkmanager.h"
+
+// The length of the description preview, in characters.
+static const int PreviewLength = 200;
+
+/**
+ * The setting is shared by all the episodes. An MGConfItem is a QObject
+ * that watches the setting, too much to have one in every episode.
+ */
+static MGConfItem *saveOnSDCardConf()
+{
+    static MGConfItem *conf = new MGConfItem("/apps/ControlPanel/Podcatcher/saveOnSDCard");
+    return conf;
+}
+
+PodcastEpisodeData::PodcastEpisodeData() :
+    dbid(0),
+    channelid(0),
+    published(0),
+    lastPlayed(0),
+    downloadSize(0),
+    playFilename(""),
+    dirtyFields(0),
+    state(PodcastEpisode::GetState),
+    hasBeenCanceled(false),
+    savedAsDownloaded(false),
+    savedAsUnplayed(false)
+{
+}
+
+bool PodcastEpisodeData::setPlayFilename(const QString &newPlayFilename)
+{
+    if (newPlayFilename == playFilename) {
+        return false;
+    }
+
+    playFilename = newPlayFilename;
+    dirtyFields |= PodcastEpisode::PlayFilenameField;
+    return true;
+}
+
+bool PodcastEpisodeData::setPublished(uint newPublished)
+{
+    if (newPublished == published) {
+        return false;
+    }
+
+    published = newPublished;
+    publishedText.clear();
+    dirtyFields |= PodcastEpisode::PubTimeField;
+    return true;
+}
+
+bool PodcastEpisodeData::setLastPlayed(uint newLastPlayed)
+{
+    if (newLastPlayed == lastPlayed) {
+        return false;
+    }
+
+    lastPlayed = newLastPlayed;
+    lastPlayedText.clear();
+    dirtyFields |= PodcastEpisode::LastPlayedField;
+    return true;
+}
+
+/**
+ * A canceled episode is not downloaded again automatically.
+ */
+bool PodcastEpisodeData::setHasBeenCanceled(bool canceled)
+{
+    if (canceled) {
+        state = PodcastEpisode::CanceledState;
+    }
+
+    if (canceled == hasBeenCanceled) {
+        return false;
+    }
+
+    hasBeenCanceled = canceled;
+    dirtyFields |= PodcastEpisode::CanceledField;
+    return true;
+}
+
+void PodcastEpisodeData::setAsPlayed()
+{
+    setLastPlayed(QDateTime::currentDateTime().toTime_t());
+}
+
+void PodcastEpisodeData::setAsUnplayed()
+{
+    setLastPlayed(0);
+    state = PodcastEpisode::DownloadedState;
+}
+
+/**
+ * The downloaded file is gone: the episode can be downloaded again.
+ */
+void PodcastEpisodeData::forgetDownload()
+{
+    setPlayFilename("");
+    setLastPlayed(0);
+    state = PodcastEpisode::GetState;
+}
+
+void PodcastEpisodeData::deleteDownload()
+{
+    if (playFilename.isEmpty()) {
+        return;
+    } else {
+        qDebug() << "Deleting locally downloaded podcast:" << playFilename;
+    }
+
+    QFile download(playFilename);
+    if (!download.remove()) {
+        QFileInfo fi(download);
+        qWarning() << "Unable to remove locally downloaded podcast:" << fi.canonicalFilePath();
+    }
+
+    forgetDownload();
+    setHasBeenCanceled(true);             // TODO: This will denote to the UI not to download it again automatically. Better method name would be good.
+}
+
+bool PodcastEpisodeData::isDownloaded() const
+{
+    return !playFilename.isEmpty();
+}
+
+bool PodcastEpisodeData::isUnplayed() const
+{
+    // An invalid last played time is saved as 0.
+    return isDownloaded() && lastPlayed == 0;
+}
+
+void PodcastEpisodeData::setSavedToDB()
+{
+    savedAsDownloaded = isDownloaded();
+    savedAsUnplayed = isUnplayed();
+    dirtyFields = 0;
+}
 
 PodcastEpisode::PodcastEpisode(QObject *parent) :
-    QObject(parent),
-    m_dlNetworkManager(0)
+    QObject(parent)
 {
-    m_state = PodcastEpisode::GetState;
     m_bytesDownloaded = 0;
-    m_lastPlayed = QDateTime();
-    m_hasBeenCanceled = false;
     m_currentDownload = 0;
-    m_playFilename = "";
+    m_streamResolverTries = 0;
+    m_resolvingStream = false;
+}
 
-    m_saveOnSDCOnf = new MGConfItem("/apps/ControlPanel/Podcatcher/saveOnSDCard", this);
+PodcastEpisode::PodcastEpisode(const PodcastEpisodeData &data, QObject *parent) :
+    QObject(parent),
+    m_data(data)
+{
+    m_bytesDownloaded = 0;
+    m_currentDownload = 0;
+    m_streamResolverTries = 0;
+    m_resolvingStream = false;
+}
 
+const PodcastEpisodeData &PodcastEpisode::data() const
+{
+    return m_data;
 }
 
 void PodcastEpisode::setTitle(const QString &title)
 {
-    m_title = title;
+    if (title != m_data.title) {
+        m_data.title = title;
+        m_data.dirtyFields |= TitleField;
+    }
 }
 
 QString PodcastEpisode::title() const
 {
-    return m_title;
+    return m_data.title;
 }
 
 void PodcastEpisode::setDownloadLink(const QString &downloadLink)
 {
-    m_downloadLink = downloadLink;
+    if (downloadLink != m_data.downloadLink) {
+        m_data.downloadLink = downloadLink;
+        m_data.dirtyFields |= DownloadLinkField;
+    }
 }
 
 QString PodcastEpisode::downloadLink() const
 {
-    if (m_downloadLink.isEmpty()) {
+    if (m_data.downloadLink.isEmpty()) {
         qWarning() << "Download link for postcast is empty! Cannot download.";
     }
-    return m_downloadLink;
+    return m_data.downloadLink;
 }
 
 void PodcastEpisode::setDescription(const QString &desc)
 {
-    m_description = desc;
+    if (desc != m_description) {
+        m_description = desc;
+        m_data.preview.clear();
+    }
 }
 
 QString PodcastEpisode::description() const
@@ -74,34 +234,81 @@ QString PodcastEpisode::description() const
     return m_description;
 }
 
+/**
+ * Episodes read from the DB only have the preview. The description is
+ * read from the DB when it is needed.
+ */
+void PodcastEpisode::setPreview(const QString &preview)
+{
+    m_data.preview = preview;
+}
+
+QString PodcastEpisode::preview() const
+{
+    if (m_data.preview.isEmpty() && !m_description.isEmpty()) {
+        return descriptionPreview(m_description);
+    }
+
+    return m_data.preview;
+}
+
+QString PodcastEpisode::plainText(const QString &html)
+{
+    QString text = html;
+    text.remove(QRegExp("<[^>]*>"));
+    text.replace("&nbsp;", " ");
+    text.replace("&lt;", "<");
+    text.replace("&gt;", ">");
+    text.replace("&quot;", "\"");
+    text.replace("&#39;", "'");
+    text.replace("&amp;", "&");
+    return text.simplified();
+}
+
+QString PodcastEpisode::descriptionPreview(const QString &description)
+{
+    QString preview = plainText(description);
+    if (preview.length() > PreviewLength) {
+        preview = preview.left(PreviewLength - 1).trimmed() + QChar(0x2026);
+    }
+
+    return preview;
+}
+
 void PodcastEpisode::setPubTime(const QDateTime &pubDate)
 {
-    m_pubDateTime = pubDate;
+    m_data.setPublished(pubDate.isValid() ? pubDate.toTime_t() : 0);
 }
 
 QDateTime PodcastEpisode::pubTime() const
 {
-    return m_pubDateTime;
+    return (m_data.published == 0) ? QDateTime() : QDateTime::fromTime_t(m_data.published);
 }
 
 void PodcastEpisode::setDuration(const QString &duration)
 {
-    m_duration = duration;
+    if (duration != m_data.duration) {
+        m_data.duration = duration;
+        m_data.dirtyFields |= DurationField;
+    }
 }
 
 QString PodcastEpisode::duration() const
 {
-    return m_duration;
+    return m_data.duration;
 }
 
 void PodcastEpisode::setDownloadSize(qint64 downloadSize)
 {
-    m_downloadSize = downloadSize;
+    if (downloadSize != m_data.downloadSize) {
+        m_data.downloadSize = downloadSize;
+        m_data.dirtyFields |= DownloadSizeField;
+    }
 }
 
 qint64 PodcastEpisode::downloadSize() const
 {
-    return m_downloadSize;
+    return m_data.downloadSize;
 }
 
 qint64 PodcastEpisode::alreadyDownloaded()
@@ -111,95 +318,98 @@ qint64 PodcastEpisode::alreadyDownloaded()
 
 void PodcastEpisode::setDbId(int id)
 {
-    m_dbid = id;
+    m_data.dbid = id;
 }
 
 
 int PodcastEpisode::dbid() const
 {
-    return m_dbid;
+    return m_data.dbid;
 }
 
 void PodcastEpisode::setState(PodcastEpisode::EpisodeStates newState)
 {
-    if (m_state != newState) {
+    if (m_data.state != newState) {
         qDebug() << "Setting episode state to " << newState;
-        m_state = newState;
+        m_data.state = newState;
         emit episodeChanged();
     }
 }
 
-QString PodcastEpisode::episodeState() const
+PodcastEpisode::EpisodeStates PodcastEpisode::state() const
+{
+    return static_cast<EpisodeStates>(m_data.state);
+}
+
+PodcastEpisode::EpisodeStatus PodcastEpisode::episodeStatus() const
+{
+    return episodeStatus(m_data);
+}
+
+PodcastEpisode::EpisodeStatus PodcastEpisode::episodeStatus(const PodcastEpisodeData &episode)
 {
 
     // Optimize: since downloading is asked several times during downloading, put it here first.
-    if (m_state == DownloadingState) {
-        return QString("downloading");
+    if (episode.state == DownloadingState) {
+        return DownloadingStatus;
     }
 
-    if (m_lastPlayed.isValid()) {
-        return "played";
+    if (episode.lastPlayed != 0) {
+        return PlayedStatus;
     }
 
-    if (!m_playFilename.isEmpty()) {
-        return "downloaded";
+    if (!episode.playFilename.isEmpty()) {
+        return DownloadedStatus;
     }
 
-    if (!m_hasBeenCanceled) {
-        if (m_downloadLink.isEmpty()) {
-            return "undownloadable";
+    if (!episode.hasBeenCanceled) {
+        if (episode.downloadLink.isEmpty()) {
+            return UndownloadableStatus;
         }
     }
 
-    switch(m_state) {
+    switch(episode.state) {
     case DownloadedState:
-        return QString("downloaded");
+        return DownloadedStatus;
         break;
     case QueuedState:
-        return QString("queued");
+        return QueuedStatus;
         break;
     case GetState:
     case CanceledState:
     default:
-        return QString("get");
+        return GetStatus;
         break;
     }
 }
 
 void PodcastEpisode::setPlayFilename(const QString &playFilename)
 {
-    if (playFilename != m_playFilename) {
-        m_playFilename = playFilename;
+    if (m_data.setPlayFilename(playFilename)) {
         emit episodeChanged();
     }
 }
 
 QString PodcastEpisode::playFilename() const
 {
-    return m_playFilename;
+    return m_data.playFilename;
 }
 
 void PodcastEpisode::setChannelId(int id)
 {
-    m_channelid = id;
+    m_data.channelid = id;
 }
 
 int PodcastEpisode::channelid() const
 {
-    return m_channelid;
+    return m_data.channelid;
 }
 
 void PodcastEpisode::downloadEpisode()
 {
-    qDebug() << "Downloading podcast:" << m_downloadLink;
+    qDebug() << "Downloading podcast:" << m_data.downloadLink;
 
-    if (m_dlNetworkManager == 0) {
-        qWarning() << "No QNetworkAccessManager specified for this episode. Cannot proceed.";
-        return;
-    }
-
-
-    QUrl downloadUrl(m_downloadLink);
+    QUrl downloadUrl(m_data.downloadLink);
     if (!downloadUrl.isValid()) {
         qWarning() << "Provided podcast download URL is not valid.";
         return;
@@ -210,12 +420,11 @@ void PodcastEpisode::downloadEpisode()
         downloadUrl.setPassword(m_password);
     }
 
-    QNetworkRequest request;
-    request.setUrl(downloadUrl);
-    request.setRawHeader("User-Agent", "Podcatcher Podcast client");
+    PodcastNetworkManager *network = PodcastNetworkManager::networkManager();
+    QNetworkRequest request = network->request(downloadUrl, PodcastNetworkManager::EpisodeDownloadRequest);
     request.setRawHeader( "Accept" , "*/*" );
 
-    m_currentDownload = m_dlNetworkManager->get(request);
+    m_currentDownload = network->get(request);
 
     connect(m_currentDownload, SIGNAL(finished()),
             this, SLOT(onPodcastEpisodeDownloadCompleted()));
@@ -229,7 +438,7 @@ void PodcastEpisode::onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
     Q_UNUSED(bytesTotal)
 
     m_bytesDownloaded = bytesReceived;
-    m_downloadSize = bytesTotal;
+    m_data.downloadSize = bytesTotal;
     emit episodeChanged();
 }
 
@@ -239,7 +448,7 @@ void PodcastEpisode::onPodcastEpisodeDownloadCompleted()
 
     QString redirectedUrl = PodcastManager::redirectedRequest(reply);
     if (redirectedUrl.isEmpty() == false) {
-        m_downloadLink = redirectedUrl;
+        m_data.downloadLink = redirectedUrl;
         reply->deleteLater();
         downloadEpisode();
         return;
@@ -294,40 +503,31 @@ void PodcastEpisode::onPodcastEpisodeDownloadCompleted()
     //
     file.close();
 
+    // Saved to the DB when the state of the download is.
     QFileInfo fileInfo(file);
-    m_playFilename = fileInfo.absoluteFilePath();
+    m_data.setPlayFilename(fileInfo.absoluteFilePath());
 
-    qDebug() << "Podcast downloaded: " << m_playFilename;
+    qDebug() << "Podcast downloaded: " << m_data.playFilename;
 
     emit podcastEpisodeDownloaded(this);
     reply->deleteLater();
-    m_dlNetworkManager = 0;
-}
-
-void PodcastEpisode::setDownloadManager(QNetworkAccessManager *qnam)
-{
-    m_dlNetworkManager = qnam;
 }
 
 void PodcastEpisode::setLastPlayed(const QDateTime &lastPlayed)
 {
-    if (lastPlayed != m_lastPlayed) {
-        m_lastPlayed = lastPlayed;
+    if (m_data.setLastPlayed(lastPlayed.isValid() ? lastPlayed.toTime_t() : 0)) {
         emit episodeChanged();
     }
 }
 
 QDateTime PodcastEpisode::lastPlayed() const
 {
-    return m_lastPlayed;
+    return (m_data.lastPlayed == 0) ? QDateTime() : QDateTime::fromTime_t(m_data.lastPlayed);
 }
 
 void PodcastEpisode::setHasBeenCanceled(bool canceled)
 {
-    canceled ? m_state = PodcastEpisode::CanceledState : m_state = m_state;
-
-    if (canceled != m_hasBeenCanceled) {
-        m_hasBeenCanceled = canceled;
+    if (m_data.setHasBeenCanceled(canceled)) {
         emit episodeChanged();
     }
 
@@ -341,13 +541,13 @@ void PodcastEpisode::setCredentails(const QString &user, const QString &password
 
 bool PodcastEpisode::hasBeenCanceled() const
 {
-    return m_hasBeenCanceled;
+    return m_data.hasBeenCanceled;
 }
 
 void PodcastEpisode::cancelCurrentDownload()
 {
     if (m_currentDownload != 0 &&
-            m_state == DownloadingState) {
+            m_data.state == DownloadingState) {
         qDebug() << "Canceling current episode download request...";
 
         setHasBeenCanceled(true);
@@ -364,34 +564,56 @@ void PodcastEpisode::cancelCurrentDownload()
 
 void PodcastEpisode::deleteDownload()
 {
-    if (m_playFilename.isEmpty()) {
+    if (m_data.playFilename.isEmpty()) {
         return;
-    } else {
-        qDebug() << "Deleting locally downloaded podcast:" << m_playFilename;
-    }
-
-    QFile download(m_playFilename);
-    if (!download.remove()) {
-        QFileInfo fi(download);
-        qWarning() << "Unable to remove locally downloaded podcast:" << fi.canonicalFilePath();
     }
 
     cancelCurrentDownload();
-    setPlayFilename("");
-    setLastPlayed(QDateTime());
-    setState(PodcastEpisode::GetState);
-    setHasBeenCanceled(true);             // TODO: This will denote to the UI not to download it again automatically. Better method name would be good.
+    m_data.deleteDownload();
+    emit episodeChanged();
 }
 
 void PodcastEpisode::setAsPlayed()
 {
-    setLastPlayed(QDateTime::currentDateTime());
+    if (m_data.setLastPlayed(QDateTime::currentDateTime().toTime_t())) {
+        emit episodeChanged();
+    }
 }
 
 void PodcastEpisode::setAsUnplayed()
 {
-    setLastPlayed(QDateTime());
-    setState(EpisodeStates::DownloadedState);
+    m_data.setAsUnplayed();
+    emit episodeChanged();
+}
+
+bool PodcastEpisode::isDownloaded() const
+{
+    return m_data.isDownloaded();
+}
+
+bool PodcastEpisode::isUnplayed() const
+{
+    return m_data.isUnplayed();
+}
+
+bool PodcastEpisode::isSavedAsDownloaded() const
+{
+    return m_data.savedAsDownloaded;
+}
+
+bool PodcastEpisode::isSavedAsUnplayed() const
+{
+    return m_data.savedAsUnplayed;
+}
+
+int PodcastEpisode::dirtyFields() const
+{
+    return m_data.dirtyFields;
+}
+
+void PodcastEpisode::setSavedToDB()
+{
+    m_data.setSavedToDB();
 }
 
 
@@ -404,56 +626,74 @@ void PodcastEpisode::setAsUnplayed()
 void PodcastEpisode::getAudioUrl()
 {
     m_streamResolverTries = 0;
-    m_streamResolverManager = new QNetworkAccessManager(this);
-    QNetworkRequest request;
+    m_resolvingStream = true;
+    PodcastNetworkManager *network = PodcastNetworkManager::networkManager();
     QUrl url = this->downloadLink();
     if(url.userName().isEmpty()){
         url.setUserName(m_user);
         url.setPassword(m_password);
     }
-    request.setUrl(this->downloadLink());
+    QNetworkRequest request = network->request(QUrl(this->downloadLink()), PodcastNetworkManager::StreamResolverRequest);
 
-    QNetworkReply *reply = m_streamResolverManager->get(request);
+    QNetworkReply *reply = network->get(request);
     connect(reply, SIGNAL(metaDataChanged()),
             this,  SLOT(onAudioUrlMetadataChanged()));
 
+    // A request that fails before any headers only finishes.
+    connect(reply, SIGNAL(finished()),
+            this,  SLOT(onAudioUrlMetadataChanged()));
 }
 
 void PodcastEpisode::onAudioUrlMetadataChanged()
 {
     QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
 
+    // We only need the headers. The network manager is shared, so abort the request
+    // ourselves instead of letting it download the whole episode.
+    disconnect(reply, 0, this, 0);
+    reply->abort();
+    reply->deleteLater();
+
     if (m_streamResolverTries >= 5) {
         qDebug() << "Did not find a proper audio URL to stream! Giving up after " << m_streamResolverTries << " tries.";
+        m_resolvingStream = false;
         emit streamingUrlResolved("", "");
-        m_streamResolverManager->deleteLater();
+        return;
     }
 
     if (isValidAudiofile(reply)) {
-        emit streamingUrlResolved(reply->url().toString(), m_title);
-        m_streamResolverManager->deleteLater();
+        m_resolvingStream = false;
+        emit streamingUrlResolved(reply->url().toString(), m_data.title);
     } else {
         QString redirectedUrl = PodcastManager::redirectedRequest(reply);
 
         if (QUrl(redirectedUrl).isValid()) {
             qDebug() << "We have been redirected...";
-            QNetworkRequest request;
-            request.setUrl(redirectedUrl);
+            PodcastNetworkManager *network = PodcastNetworkManager::networkManager();
+            QNetworkRequest request = network->request(QUrl(redirectedUrl), PodcastNetworkManager::StreamResolverRequest);
 
-            QNetworkReply *newReply = m_streamResolverManager->get(request);
+            QNetworkReply *newReply = network->get(request);
             connect(newReply, SIGNAL(metaDataChanged()),
                     this,  SLOT(onAudioUrlMetadataChanged()));
+            connect(newReply, SIGNAL(finished()),
+                    this,  SLOT(onAudioUrlMetadataChanged()));
 
             m_streamResolverTries++;
 
         } else {
             qDebug() << "Error resolving streaming URL!";
+            m_resolvingStream = false;
             emit streamingUrlResolved("", "");
-            m_streamResolverManager->deleteLater();
         }
     }
+}
 
-    reply->deleteLater();
+/**
+ * True from getAudioUrl() until streamingUrlResolved() is emitted.
+ */
+bool PodcastEpisode::isResolvingStream() const
+{
+    return m_resolvingStream;
 }
 
 bool PodcastEpisode::isValidAudiofile(QNetworkReply *reply) const
@@ -477,7 +717,7 @@ bool PodcastEpisode::isValidAudiofile(QNetworkReply *reply) const
 
 QString PodcastEpisode::getDownloadDir()
 {
-    if(!m_saveOnSDCOnf->value().toBool())
+    if(!saveOnSDCardConf()->value().toBool())
         return PODCATCHER_PODCAST_DLDIR;
     else {
         QString path = "/media/sdcard/";
@@ -495,7 +735,7 @@ QString PodcastEpisode::getDownloadDir()
         }
 
         if(sd.isEmpty()){ //no SD mounted
-            m_saveOnSDCOnf->set(false);
+            saveOnSDCardConf()->set(false);
             return PODCATCHER_PODCAST_DLDIR;
         }
 
@@ -21,14 +21,65 @@
 #include <QObject>
 #include <QString>
 #include <QDateTime>
-#include <QNetworkAccessManager>
+#include <QNetworkReply>
 
-#include <MGConfItem>
+/**
+ * An episode as the episode models keep it, one after the other in a
+ * vector. Thousands of episodes can be in memory, so it only has what the
+ * episode list shows and what is saved to the DB, in small fields. The
+ * strings are implicitly shared with the copies.
+ */
+struct PodcastEpisodeData
+{
+    PodcastEpisodeData();
+
+    // The setters of the fields that change after the episode is saved.
+    // They mark the field as changed, and return true if it changed.
+    bool setPlayFilename(const QString &playFilename);
+    bool setPublished(uint published);
+    bool setLastPlayed(uint lastPlayed);
+    bool setHasBeenCanceled(bool canceled);
+
+    void setAsPlayed();
+    void setAsUnplayed();
+    void forgetDownload();
+    void deleteDownload();
 
+    // How the episode counts in its channel's episode counters.
+    bool isDownloaded() const;
+    bool isUnplayed() const;
+    void setSavedToDB();
+
+    int dbid;
+    int channelid;
+    uint published;         // Seconds since the epoch, 0 when not set.
+    uint lastPlayed;        // Seconds since the epoch, 0 when never played.
+    qint64 downloadSize;
+    QString title;
+    QString downloadLink;
+    QString playFilename;
+    QString preview;
+    QString duration;
+    quint16 dirtyFields;    // PodcastEpisode::DirtyField flags.
+    quint8 state;           // A PodcastEpisode::EpisodeStates.
+    bool hasBeenCanceled;
+    bool savedAsDownloaded;
+    bool savedAsUnplayed;
+
+    // The dates as shown, formatted when first shown. The setters of the
+    // dates clear them.
+    mutable QString publishedText;
+    mutable QString lastPlayedText;
+};
 
+/**
+ * An episode with its description, as parsed from a feed, or the controller
+ * of an episode of a model while it is downloaded or streamed.
+ */
 class PodcastEpisode : public QObject
 {
     Q_OBJECT
+    Q_ENUMS(EpisodeStatus)
 public:
     enum EpisodeStates {
         GetState = 0,
@@ -39,7 +90,31 @@ public:
         PlayedState
     };
 
+    // How the episode is shown in the UI.
+    enum EpisodeStatus {
+        GetStatus = 0,
+        QueuedStatus,
+        DownloadingStatus,
+        DownloadedStatus,
+        PlayedStatus,
+        UndownloadableStatus
+    };
+
+    // The fields that are saved to the DB, for tracking which ones changed.
+    // The description is only saved with a new episode.
+    enum DirtyField {
+        TitleField        = 0x001,
+        DownloadLinkField = 0x002,
+        PlayFilenameField = 0x004,
+        PubTimeField      = 0x010,
+        DurationField     = 0x020,
+        DownloadSizeField = 0x040,
+        LastPlayedField   = 0x080,
+        CanceledField     = 0x100
+    };
+
     explicit PodcastEpisode(QObject *parent = 0);
+    explicit PodcastEpisode(const PodcastEpisodeData &data, QObject *parent = 0);
 
     void downloadEpisode();
 
@@ -49,36 +124,56 @@ public:
     void setDownloadLink(const QString &downloadLink);
     void setPlayFilename(const QString &playFilename);
     void setDescription(const QString &desc);
+    void setPreview(const QString &preview);
     void setPubTime(const QDateTime &pubDate);
     void setDuration(const QString &duration);
     void setDownloadSize(qint64 downloadSize);
     void setState(EpisodeStates newState);
-    void setDownloadManager(QNetworkAccessManager *qnam);
     void setLastPlayed(const QDateTime &lastPlayed);
     void setHasBeenCanceled(bool canceled);
 
     void setCredentails(const QString& user, const  QString& password);
 
+    const PodcastEpisodeData &data() const;
+
     int dbid() const;
     int channelid() const;
     QString title() const;
     QString downloadLink() const;
     QString playFilename() const;
     QString description() const;
+    QString preview() const;
     QDateTime pubTime() const;
     QString duration() const;
     qint64 downloadSize() const;
     qint64 alreadyDownloaded();
-    QString episodeState() const;
+    EpisodeStates state() const;
+    EpisodeStatus episodeStatus() const;
     QDateTime lastPlayed() const;
     bool hasBeenCanceled() const;
     void getAudioUrl();
+    bool isResolvingStream() const;
 
     void cancelCurrentDownload();
     void deleteDownload();
     void setAsPlayed();
     void setAsUnplayed();
 
+    // How the episode counts in its channel's episode counters: now, and
+    // as it was last saved to the DB.
+    bool isDownloaded() const;
+    bool isUnplayed() const;
+    bool isSavedAsDownloaded() const;
+    bool isSavedAsUnplayed() const;
+    int dirtyFields() const;
+    void setSavedToDB();
+
+    static EpisodeStatus episodeStatus(const PodcastEpisodeData &episode);
+
+    // The description as plain text, and its start for the episode lists.
+    static QString plainText(const QString &html);
+    static QString descriptionPreview(const QString &description);
+
 signals:
     void episodeChanged();
     void podcastEpisodeDownloaded(PodcastEpisode *episode);
@@ -99,30 +194,17 @@ private:
 
     //bool isOnlyWebsiteUrl() const;
 
-    int m_dbid;
-    int m_channelid;
-    QString m_title;
-    QString m_downloadLink;
-    QString m_playFilename;
+    PodcastEpisodeData m_data;
     QString m_description;
-    QDateTime m_pubDateTime;
-    QString m_duration;
-    EpisodeStates m_state;
     qint64 m_bytesDownloaded;
-    qint64 m_downloadSize;
-    QDateTime m_lastPlayed;
-    bool m_hasBeenCanceled;
 
     QString m_user;
     QString m_password;
 
-    QNetworkAccessManager *m_dlNetworkManager;
     QNetworkReply *m_currentDownload;
 
-    QNetworkAccessManager *m_streamResolverManager;
     int m_streamResolverTries;
-
-   MGConfItem *m_saveOnSDCOnf;
+    bool m_resolvingStream;
 };
 
 #endif // PODCASTEPISODE_H
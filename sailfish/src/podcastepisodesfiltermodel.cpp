@@ -0,0 +1,198 @@
+/**
+ * This file is part of Podcatcher for Sailfish OS.
+ * Author: Johan Paul (johan.paul@gmail.com)
+ *
+ * Podcatcher for Sailfish OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Podcatcher for Sailfish OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "podcastepisodesfiltermodel.h"
+
+PodcastEpisodesFilterModel::PodcastEpisodesFilterModel(QObject *parent) :
+    QSortFilterProxyModel(parent),
+    m_filter(AllEpisodes)
+{
+}
+
+/**
+ * Filters the episodes of the model. The index is connected to the model
+ * before the proxy, so that it is up to date when the proxy filters the
+ * changed rows.
+ */
+void PodcastEpisodesFilterModel::setEpisodesModel(PodcastEpisodesModel *episodesModel)
+{
+    if (episodesModel == m_episodesModel) {
+        return;
+    }
+
+    if (!m_episodesModel.isNull()) {
+        disconnect(m_episodesModel, SIGNAL(rowsInserted(QModelIndex,int,int)),
+                   this, SLOT(onRowsInserted(QModelIndex,int,int)));
+        disconnect(m_episodesModel, SIGNAL(rowsRemoved(QModelIndex,int,int)),
+                   this, SLOT(onRowsRemoved(QModelIndex,int,int)));
+        disconnect(m_episodesModel, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+                   this, SLOT(onDataChanged(QModelIndex,QModelIndex)));
+        disconnect(m_episodesModel, SIGNAL(modelReset()),
+                   this, SLOT(onModelReset()));
+    }
+
+    m_episodesModel = episodesModel;
+
+    if (!m_episodesModel.isNull()) {
+        connect(m_episodesModel, SIGNAL(rowsInserted(QModelIndex,int,int)),
+                this, SLOT(onRowsInserted(QModelIndex,int,int)));
+        connect(m_episodesModel, SIGNAL(rowsRemoved(QModelIndex,int,int)),
+                this, SLOT(onRowsRemoved(QModelIndex,int,int)));
+        connect(m_episodesModel, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+                this, SLOT(onDataChanged(QModelIndex,QModelIndex)));
+        connect(m_episodesModel, SIGNAL(modelReset()),
+                this, SLOT(onModelReset()));
+    }
+
+    onModelReset();
+    setSourceModel(m_episodesModel);
+    fetchAllForFilter();
+}
+
+PodcastEpisodesFilterModel::EpisodeFilter PodcastEpisodesFilterModel::filter() const
+{
+    return m_filter;
+}
+
+void PodcastEpisodesFilterModel::setFilter(EpisodeFilter filter)
+{
+    if (filter == m_filter) {
+        return;
+    }
+
+    m_filter = filter;
+    fetchAllForFilter();
+    invalidateFilter();
+    emit filterChanged();
+}
+
+QString PodcastEpisodesFilterModel::searchText() const
+{
+    return m_searchText;
+}
+
+void PodcastEpisodesFilterModel::setSearchText(const QString &searchText)
+{
+    QString text = searchText.trimmed().toLower();
+    if (text == m_searchText) {
+        return;
+    }
+
+    m_searchText = text;
+    fetchAllForFilter();
+    invalidateFilter();
+    emit searchTextChanged();
+}
+
+bool PodcastEpisodesFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &) const
+{
+    if (sourceRow < 0 || sourceRow >= m_rowFilters.size()) {
+        return true;
+    }
+
+    if (!(m_rowFilters.at(sourceRow) & (1 << m_filter))) {
+        return false;
+    }
+
+    return m_searchText.isEmpty() || m_searchKeys.at(sourceRow).contains(m_searchText);
+}
+
+void PodcastEpisodesFilterModel::onRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    m_rowFilters.insert(first, last - first + 1, 0);
+    for (int row=first; row<=last; row++) {
+        m_searchKeys.insert(row, QString());
+        updateRow(row);
+    }
+}
+
+void PodcastEpisodesFilterModel::onRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    m_rowFilters.remove(first, last - first + 1);
+    m_searchKeys.erase(m_searchKeys.begin() + first, m_searchKeys.begin() + last + 1);
+}
+
+void PodcastEpisodesFilterModel::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    for (int row=topLeft.row(); row<=bottomRight.row(); row++) {
+        updateRow(row);
+    }
+}
+
+void PodcastEpisodesFilterModel::onModelReset()
+{
+    m_rowFilters.clear();
+    m_searchKeys.clear();
+
+    if (m_episodesModel.isNull()) {
+        return;
+    }
+
+    int rows = m_episodesModel->rowCount();
+    m_rowFilters.fill(0, rows);
+    m_searchKeys.reserve(rows);
+    for (int row=0; row<rows; row++) {
+        m_searchKeys << QString();
+        updateRow(row);
+    }
+}
+
+void PodcastEpisodesFilterModel::updateRow(int row)
+{
+    const PodcastEpisodeData *episode = m_episodesModel->episode(row);
+    if (episode == 0 || row >= m_rowFilters.size()) {
+        return;
+    }
+
+    PodcastEpisode::EpisodeStatus status = PodcastEpisode::episodeStatus(*episode);
+
+    quint8 filters = (1 << AllEpisodes);
+    if (episode->isUnplayed()) {
+        filters |= (1 << UnplayedEpisodes);
+    }
+    if (episode->isDownloaded()) {
+        filters |= (1 << DownloadedEpisodes);
+    }
+    if (status == PodcastEpisode::UndownloadableStatus) {
+        filters |= (1 << UndownloadableEpisodes);
+    }
+
+    m_rowFilters[row] = filters;
+    m_searchKeys[row] = episode->title.toLower();
+}
+
+/**
+ * The episodes model reads its episodes from the DB a page at a time. A
+ * filter that hides rows needs all of them, once, so that it finds the
+ * older matching episodes too.
+ */
+void PodcastEpisodesFilterModel::fetchAllForFilter()
+{
+    if (m_episodesModel.isNull() || (m_filter == AllEpisodes && m_searchText.isEmpty())) {
+        return;
+    }
+
+    m_episodesModel->fetchAll();
+}
@@ -0,0 +1,88 @@
+/**
+ * This file is part of Podcatcher for Sailfish OS.
+ * Author: Johan Paul (johan.paul@gmail.com)
+ *
+ * Podcatcher for Sailfish OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Podcatcher for Sailfish OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PODCASTEPISODESFILTERMODEL_H
+#define PODCASTEPISODESFILTERMODEL_H
+
+#include <QPointer>
+#include <QSortFilterProxyModel>
+#include <QStringList>
+#include <QVector>
+
+#include "podcastepisodesmodel.h"
+
+/**
+ * The episodes of a channel that pass a filter and contain a search text
+ * in their title. The filters each row passes and the lowercase titles are
+ * kept in an index next to the rows of the episodes model, so changing the
+ * filter only checks a bit of each row.
+ */
+class PodcastEpisodesFilterModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+    Q_ENUMS(EpisodeFilter)
+    Q_PROPERTY(EpisodeFilter filter READ filter WRITE setFilter NOTIFY filterChanged)
+    Q_PROPERTY(QString searchText READ searchText WRITE setSearchText NOTIFY searchTextChanged)
+
+public:
+    enum EpisodeFilter {
+        AllEpisodes = 0,
+        UnplayedEpisodes,
+        DownloadedEpisodes,
+        UndownloadableEpisodes
+    };
+
+    explicit PodcastEpisodesFilterModel(QObject *parent = 0);
+
+    void setEpisodesModel(PodcastEpisodesModel *episodesModel);
+
+    EpisodeFilter filter() const;
+    void setFilter(EpisodeFilter filter);
+
+    QString searchText() const;
+    void setSearchText(const QString &searchText);
+
+signals:
+    void filterChanged();
+    void searchTextChanged();
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const;
+
+private slots:
+    void onRowsInserted(const QModelIndex &parent, int first, int last);
+    void onRowsRemoved(const QModelIndex &parent, int first, int last);
+    void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void onModelReset();
+
+private:
+    void updateRow(int row);
+    void fetchAllForFilter();
+
+    // The model of a removed channel is deleted while it is shown.
+    QPointer<PodcastEpisodesModel> m_episodesModel;
+
+    // For each row of the episodes model: bit n is set when the episode
+    // passes EpisodeFilter n, and the title in lowercase.
+    QVector<quint8> m_rowFilters;
+    QStringList m_searchKeys;
+
+    EpisodeFilter m_filter;
+    QString m_searchText;
+};
+
+#endif // PODCASTEPISODESFILTERMODEL_H
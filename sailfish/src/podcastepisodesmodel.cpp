@@ -16,6 +16,7 @@
  * You should have received a copy of the GNU General Public License
  * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <QCoreApplication>
 #include <QHash>
 #include <QVariant>
 #include <QDateTime>
@@ -26,24 +27,82 @@
 #include "podcastmanager.h"
 #include "podcastepisodesmodel.h"
 
+// The episodes fetched from the DB at a time. About two screenfuls.
+static const int EpisodesPageSize = 30;
+
+/**
+ * The progress of a download, as it was formatted in the episode list.
+ */
+static QString downloadStatusText(qint64 alreadyDownloadedSize, qint64 totalDownloadSize)
+{
+    double downloadedKB = alreadyDownloadedSize / 1024.0;
+    double totalKB = totalDownloadSize / 1024.0;
+
+    QString currentSize;
+    if (qRound(downloadedKB / 1024) == 0) {
+        currentSize = QString("%1 kB").arg(qRound(downloadedKB));
+    } else {
+        currentSize = QString("%1 MB").arg(downloadedKB / 1024, 0, 'f', 1);
+    }
+
+    QString totalSize;
+    if (qRound(totalKB / 1024) == 0) {
+        if (qRound(totalKB) > 0) {
+            totalSize = QString("%1 kB").arg(qRound(totalKB));
+        }
+    } else {
+        totalSize = QString("%1 MB").arg(qRound(totalKB / 1024));
+    }
+
+    return QCoreApplication::translate("PodcastEpisodesList", "Downloaded %1 of total %2.").arg(currentSize, totalSize);
+}
+
+/**
+ * True while the download queue or the UI refers to the controller.
+ */
+static bool isActiveController(PodcastEpisode *controller)
+{
+    return controller->state() == PodcastEpisode::QueuedState ||
+           controller->state() == PodcastEpisode::DownloadingState ||
+           controller->isResolvingStream();
+}
+
+/**
+ * The order of the model and of the DB: newest first, and episodes
+ * published at the same time in the reverse order of their DB ids.
+ */
+bool PodcastEpisodesModel::isNewerEpisode(const PodcastEpisodeData &episode, const PodcastEpisodeData &other)
+{
+    if (episode.published != other.published) {
+        return episode.published > other.published;
+    }
+
+    return episode.dbid > other.dbid;
+}
+
 PodcastEpisodesModel::PodcastEpisodesModel(int channelId, QObject *parent) :
     QAbstractListModel(parent),
-    m_channelId(channelId)
+    m_channelId(channelId),
+    m_allFetched(false),
+    m_rowsDirty(false)
 {
     m_roles[DbidRole] = "dbid";
     m_roles[TitleRole] = "title";
     m_roles[PubRole] = "published";
     m_roles[DescriptionRole] = "description";
-    m_roles[StateRole] = "episodeState";
+    m_roles[StatusRole] = "episodeStatus";
     m_roles[TotalDownloadRole] = "totalDownloadSize";
     m_roles[AlreadyDownloaded] = "alreadyDownloadedSize";
     m_roles[LastTimePlayedRole] = "lastTimePlayed";
+    m_roles[PreviewRole] = "descriptionPreview";
+    m_roles[DownloadStatusRole] = "downloadStatusText";
     //setRoleNames(roles);
 
     m_sqlmanager = PodcastSQLManagerFactory::sqlmanager();
 }
 
 PodcastEpisodesModel::~PodcastEpisodesModel() {
+    // The controllers are children of the model. The files downloaded are kept.
 }
 
 int PodcastEpisodesModel::rowCount(const QModelIndex &) const
@@ -53,176 +112,351 @@ int PodcastEpisodesModel::rowCount(const QModelIndex &) const
 
 QVariant PodcastEpisodesModel::data(const QModelIndex &index, int role) const
 {
-    if (index.row() < 0 || index.row() > m_episodes.count())
+    if (index.row() < 0 || index.row() >= m_episodes.count())
         return QVariant();
 
-    PodcastEpisode *episode = m_episodes.at(index.row());
+    const PodcastEpisodeData &episode = m_episodes.at(index.row());
+    PodcastEpisode *controller = m_controllers.value(episode.dbid);
 
     switch(role) {
     case TitleRole:
-        return episode->title();
+        return episode.title;
         break;
     case PubRole:
-        return episode->pubTime().toString(tr("dd.MM.yyyy"));
+        if (episode.published == 0) {
+            return QString();
+        }
+        if (episode.publishedText.isEmpty()) {
+            episode.publishedText = QDateTime::fromTime_t(episode.published).toString(tr("dd.MM.yyyy"));
+        }
+        return episode.publishedText;
         break;
     case DbidRole:
-        return episode->dbid();
+        return episode.dbid;
         break;
     case DescriptionRole:
-        return episode->description();
+        // Only the preview is kept in memory.
+        return m_sqlmanager->episodeDescriptionInDB(episode.dbid);
         break;
-    case StateRole:
-        return episode->episodeState();
+    case PreviewRole:
+        return episode.preview;
+        break;
+    case StatusRole:
+        return PodcastEpisode::episodeStatus(episode);
         break;
     case TotalDownloadRole:
-        return episode->downloadSize();
+        return episode.downloadSize;
         break;
     case AlreadyDownloaded:
-        return episode->alreadyDownloaded();
+        return (controller != 0) ? controller->alreadyDownloaded() : qint64(0);
         break;
     case LastTimePlayedRole:
-        if (episode->episodeState() == "played") {
-            return QString(tr("Last played: %1")).arg(episode->lastPlayed().toString(tr("dd.MM.yyyy hh:mm")));
+        if (PodcastEpisode::episodeStatus(episode) == PodcastEpisode::PlayedStatus) {
+            if (episode.lastPlayedText.isEmpty()) {
+                episode.lastPlayedText = tr("Last played: %1").arg(QDateTime::fromTime_t(episode.lastPlayed).toString(tr("dd.MM.yyyy hh:mm")));
+            }
+            return episode.lastPlayedText;
         } else  {
             return QString();
         }
+    case DownloadStatusRole:
+        if (controller != 0 && PodcastEpisode::episodeStatus(episode) == PodcastEpisode::DownloadingStatus) {
+            return downloadStatusText(controller->alreadyDownloaded(), episode.downloadSize);
+        } else {
+            return QString();
+        }
     default:
         return QVariant();
     }
 
 }
 
-void PodcastEpisodesModel::addEpisode(PodcastEpisode *episode)
+bool PodcastEpisodesModel::canFetchMore(const QModelIndex &parent) const
 {
-    QList<PodcastEpisode *> episodes;
-    episodes << episode;
-    addEpisodes(episodes);
+    if (parent.isValid()) {
+        return false;
+    }
+
+    return !m_allFetched;
 }
 
-void PodcastEpisodesModel::addEpisodes(QList<PodcastEpisode *> episodes)
+/**
+ * Appends the next page of older episodes from the DB. The model holds the
+ * newest episodes of the channel, so the page starts after the last one.
+ */
+void PodcastEpisodesModel::fetchMore(const QModelIndex &parent)
 {
+    if (parent.isValid() || m_allFetched) {
+        return;
+    }
+
+    const PodcastEpisodeData *lastEpisode = m_episodes.isEmpty() ? 0 : &m_episodes.last();
+    QVector<PodcastEpisodeData> episodes = m_sqlmanager->episodesInDB(m_channelId, EpisodesPageSize, lastEpisode);
+    m_allFetched = (episodes.size() < EpisodesPageSize);
+
     if (episodes.isEmpty()) {
         return;
     }
 
-    QDateTime modelsLatestEpisode;
-    if (m_episodes.isEmpty()) {
-        modelsLatestEpisode = QDateTime();
-    } else {
-        modelsLatestEpisode = m_episodes.at(0)->pubTime();
-    }
-
-    QDateTime dbsLatestEpisode = m_sqlmanager->latestEpisodeTimestampInDB(m_channelId);
-    PodcastEpisode *episode;
-    QList<PodcastEpisode *> newEpisodesToAdd;
-
-    // Add the episode to the UI model if its timestamp is > modelsLatestEpisode. By default the modelsLatestEpisode
-    // is the result of the most recent model population - with or without episodes added to the DB.
-    // If the episode also has a timestmap > dbsLatestEpisode, then also add it to the DB.
-    // Last query the latest timestamp of all channel's episodes after the operation.
-    for(int i=episodes.size()-1; i>=0; i--) {
-        episode = episodes.at(i);                           // Take the last episode in the new model.
-        if (episode->pubTime() > modelsLatestEpisode) {     // If this episodes has a more recent timestamp, add to model.            qDebug() << "Adding to UI...";
-            beginInsertRows(QModelIndex(), 0, 0);
-            m_episodes.prepend(episode);                    // Since we took that last item from the new episodes model, we add this item first to the view.
-            endInsertRows();                                // When we do this for new episodes not yet in the model, all new episodes (episode->pubTime() > modelsLatestEpisode)
-                                                            // ends up on top of the list. Note that the QModelIndex is also updated accordingly.
-            episode->setChannelId(m_channelId);
-
-            connect(episode, SIGNAL(episodeChanged()),
-                    this, SLOT(onEpisodeChanged()));
-
-            if (episode->pubTime() > dbsLatestEpisode) {
-                newEpisodesToAdd << episode;
-            }
+    beginInsertRows(QModelIndex(), m_episodes.size(), m_episodes.size() + episodes.size() - 1);
+    if (!m_rowsDirty) {
+        for (int i=0; i<episodes.size(); i++) {
+            m_rows.insert(episodes.at(i).dbid, m_episodes.size() + i);
         }
     }
+    m_episodes += episodes;
+    endInsertRows();
+}
 
-    if (!newEpisodesToAdd.isEmpty()) {
-        qDebug() << "Adding new episodes to DB: " << newEpisodesToAdd.size();
-        m_sqlmanager->podcastEpisodesToDB(newEpisodesToAdd,
-                                          m_channelId);
-        m_latestEpisodeTimestamp = m_sqlmanager->latestEpisodeTimestampInDB(m_channelId);
+/**
+ * Fetches the rest of the episodes of the channel from the DB, for the
+ * operations that go through all of them.
+ */
+void PodcastEpisodesModel::fetchAll()
+{
+    while (canFetchMore(QModelIndex())) {
+        fetchMore(QModelIndex());
+    }
+}
+
+/**
+ * Adds episodes that have just been saved to the DB, sorted newest first.
+ * They are merged with the rows of the model into a new vector in one pass,
+ * which then replaces the rows. New episodes that are all in one place, as
+ * the new episodes at the top, are one insert. Episodes added between
+ * several rows, as older ones a feed filled in, reset the model. The model
+ * keeps the data of the episodes and deletes them.
+ */
+void PodcastEpisodesModel::insertSavedEpisodes(QList<PodcastEpisode *> savedEpisodes)
+{
+    QVector<PodcastEpisodeData> episodes;
+    episodes.reserve(savedEpisodes.size());
+    foreach(PodcastEpisode *savedEpisode, savedEpisodes) {
+        PodcastEpisodeData episode = savedEpisode->data();
+        episode.preview = savedEpisode->preview();
+        episodes << episode;
+    }
+    qDeleteAll(savedEpisodes);
+
+    // Episodes older than the fetched ones are left for fetchMore(), from the DB.
+    if (!m_allFetched) {
+        while (!episodes.isEmpty() &&
+               (m_episodes.isEmpty() || isNewerEpisode(m_episodes.last(), episodes.last()))) {
+            episodes.removeLast();
+        }
+    }
+
+    if (episodes.isEmpty()) {
+        return;
+    }
+
+    QVector<PodcastEpisodeData> merged;
+    merged.reserve(m_episodes.size() + episodes.size());
+
+    int firstRow = -1;
+    int runs = 0;
+    int row = 0;
+    int i = 0;
+    while (i < episodes.size()) {
+        if (row < m_episodes.size() && !isNewerEpisode(episodes.at(i), m_episodes.at(row))) {
+            merged.append(m_episodes.at(row++));
+            continue;
+        }
+
+        if (firstRow == -1) {
+            firstRow = merged.size();
+        }
+        runs++;
+
+        while (i < episodes.size() &&
+               (row == m_episodes.size() || isNewerEpisode(episodes.at(i), m_episodes.at(row)))) {
+            merged.append(episodes.at(i++));
+        }
+    }
+    while (row < m_episodes.size()) {
+        merged.append(m_episodes.at(row++));
+    }
+
+    if (runs == 1) {
+        beginInsertRows(QModelIndex(), firstRow, firstRow + episodes.size() - 1);
+        m_episodes.swap(merged);
+        m_rowsDirty = true;
+        endInsertRows();
     } else {
-        qDebug() << "No new episodes to be added to the DB.";
+        beginResetModel();
+        m_episodes.swap(merged);
+        m_rowsDirty = true;
+        endResetModel();
     }
+}
 
+const PodcastEpisodeData * PodcastEpisodesModel::episode(int index) const
+{
+    if (index < 0 || index >= m_episodes.count())
+        return 0;
+
+    return &m_episodes.at(index);
 }
 
-void PodcastEpisodesModel::delEpisode(PodcastEpisode *episode)
+/**
+ * The episode with the DB id, if it is loaded in the model. The UI refers to
+ * episodes by their DB id, which stays the same when rows are added above.
+ */
+const PodcastEpisodeData * PodcastEpisodesModel::episodeByDbId(int dbid)
 {
-    qDebug() << "Deleting episode with name: " << episode->title() << ", pub date:" << episode->pubTime();
-    for (int i=0; i<m_episodes.length(); i++) {
-        if (episode == m_episodes.at(i)) {
-            qDebug() << "Remove from model, index: " << i;
-            beginRemoveRows(QModelIndex(), i, i);
-            m_episodes.removeAt(i);
-            endRemoveRows();
+    int row = rowOfEpisode(dbid);
+    if (row == -1) {
+        return 0;
+    }
 
-            m_sqlmanager->removePodcastFromDB(episode);
-        }
+    return &m_episodes.at(row);
+}
+
+/**
+ * The controller of the episode with the DB id, for downloading or
+ * streaming it. The model keeps it while it is queued, downloading or
+ * resolving a stream, and deletes it after that.
+ */
+PodcastEpisode * PodcastEpisodesModel::episodeController(int dbid)
+{
+    PodcastEpisode *controller = m_controllers.value(dbid);
+    if (controller != 0) {
+        return controller;
     }
 
-    delete episode;
+    const PodcastEpisodeData *episode = episodeByDbId(dbid);
+    if (episode == 0) {
+        return 0;
+    }
+
+    controller = new PodcastEpisode(*episode, this);
+    connect(controller, SIGNAL(episodeChanged()),
+            this, SLOT(onEpisodeChanged()));
+    connect(controller, SIGNAL(streamingUrlResolved(QString,QString)),
+            this, SLOT(onStreamingUrlResolved()));
+    m_controllers.insert(dbid, controller);
+
+    return controller;
 }
 
-void PodcastEpisodesModel::delEpisode(int index, PodcastEpisode *episode)
+int PodcastEpisodesModel::rowOfEpisode(int dbid)
 {
-    qDebug() << "Deleting episode with name: " << episode->title() << ", pub date:" << episode->pubTime();
+    if (dbid < 1) {
+        return -1;
+    }
 
-    beginRemoveRows(QModelIndex(), index, index);
-    m_episodes.removeAt(index);
-    endRemoveRows();
+    updateRows();
+    return m_rows.value(dbid, -1);
+}
+
+void PodcastEpisodesModel::updateRows()
+{
+    if (!m_rowsDirty) {
+        return;
+    }
+
+    m_rows.clear();
+    m_rows.reserve(m_episodes.size());
+    for (int i=0; i<m_episodes.size(); i++) {
+        m_rows.insert(m_episodes.at(i).dbid, i);
+    }
+    m_rowsDirty = false;
+}
+
+/**
+ * Saves the changes of the episode in the row to the DB, and tells the
+ * views about them.
+ */
+void PodcastEpisodesModel::updateEpisode(int row)
+{
+    m_sqlmanager->updatePodcastInDB(m_episodes[row]);
+
+    QModelIndex modelIndex = createIndex(row, 0);
+    emit dataChanged(modelIndex, modelIndex);
+}
+
+/**
+ * Copies the episode of the controller to its row.
+ */
+void PodcastEpisodesModel::syncController(PodcastEpisode *controller)
+{
+    int row = rowOfEpisode(controller->dbid());
+    if (row == -1) {
+        return;
+    }
+
+    m_episodes[row] = controller->data();
 
-    m_sqlmanager->removePodcastFromDB(episode);
-    delete episode;
+    QModelIndex modelIndex = createIndex(row, 0);
+    emit dataChanged(modelIndex, modelIndex);
 }
 
-PodcastEpisode * PodcastEpisodesModel::episode(int index)
+void PodcastEpisodesModel::releaseController(PodcastEpisode *controller)
 {
-    PodcastEpisode *episode = 0;
-    if (index < 0 || index > m_episodes.count())
-        return episode;
+    if (isActiveController(controller)) {
+        return;
+    }
+
+    if (m_controllers.value(controller->dbid()) == controller) {
+        m_controllers.remove(controller->dbid());
+    }
 
-    episode = m_episodes.at(index);
-    return episode;
+    // The caller may still be using it.
+    disconnect(controller, 0, this, 0);
+    controller->deleteLater();
 }
 
 void PodcastEpisodesModel::onEpisodeChanged()
 {
-    PodcastEpisode *episode  = qobject_cast<PodcastEpisode *>(sender());
-    if (episode == 0) {
+    PodcastEpisode *controller = qobject_cast<PodcastEpisode *>(sender());
+    if (controller == 0) {
         return;
     }
 
-    int episodeIndex = m_episodes.indexOf(episode);
-    if (episodeIndex != -1) {
-        QModelIndex modelIndex = createIndex(episodeIndex, 0);
-        emit dataChanged(modelIndex, modelIndex);
+    syncController(controller);
+    releaseController(controller);
+}
+
+void PodcastEpisodesModel::onStreamingUrlResolved()
+{
+    PodcastEpisode *controller = qobject_cast<PodcastEpisode *>(sender());
+    if (controller == 0) {
+        return;
     }
+
+    releaseController(controller);
 }
 
 QList<PodcastEpisode *> PodcastEpisodesModel::undownloadedEpisodes(int max)
 {
     QList<PodcastEpisode *> episodes;
 
+    while (m_episodes.size() < max && canFetchMore(QModelIndex())) {
+        fetchMore(QModelIndex());
+    }
+
     if (m_episodes.isEmpty()) {
         return episodes;
     }
 
-    if (max > m_episodes.length()) {
-        max = m_episodes.length();
+    if (max > m_episodes.size()) {
+        max = m_episodes.size();
     }
 
+    QList<int> dbids;
     for (int i=0; i<max; i++) {
-        PodcastEpisode *episode = m_episodes.at(i);
-        if (!episode->downloadLink().isEmpty() &&
-            episode->playFilename().isEmpty() &&
-            episode->hasBeenCanceled() == false) {
-            episodes << episode;
+        const PodcastEpisodeData &episode = m_episodes.at(i);
+        if (!episode.downloadLink.isEmpty() &&
+            episode.playFilename.isEmpty() &&
+            episode.hasBeenCanceled == false) {
+            dbids << episode.dbid;
         }
     }
 
+    foreach(int dbid, dbids) {
+        episodes << episodeController(dbid);
+    }
+
     return episodes;
 }
 
@@ -241,85 +475,228 @@ int PodcastEpisodesModel::channelId()
     return m_channelId;
 }
 
+/**
+ * Saves the changes of the controller to the DB and to its row. The
+ * controller is deleted later if it is not in use anymore.
+ */
 void PodcastEpisodesModel::refreshEpisode(PodcastEpisode *episode)
 {
     qDebug() << "Saving episode to DB. Play filename:" << episode->playFilename();
-    m_sqlmanager->updatePodcastInDB(episode);
+
+    PodcastEpisodeData data = episode->data();
+    m_sqlmanager->updatePodcastInDB(data);
+    episode->setSavedToDB();
+
+    syncController(episode);
+    releaseController(episode);
+}
+
+void PodcastEpisodesModel::setPlayed(int dbid, bool played)
+{
+    PodcastEpisode *controller = m_controllers.value(dbid);
+    if (controller != 0) {
+        if (played) {
+            controller->setAsPlayed();
+        } else {
+            controller->setAsUnplayed();
+        }
+        refreshEpisode(controller);
+        return;
+    }
+
+    int row = rowOfEpisode(dbid);
+    if (row == -1) {
+        return;
+    }
+
+    if (played) {
+        m_episodes[row].setAsPlayed();
+    } else {
+        m_episodes[row].setAsUnplayed();
+    }
+    updateEpisode(row);
+}
+
+/**
+ * The downloaded file of the episode is gone.
+ */
+void PodcastEpisodesModel::forgetDownload(int dbid)
+{
+    PodcastEpisode *controller = m_controllers.value(dbid);
+    if (controller != 0) {
+        controller->setPlayFilename("");
+        controller->setState(PodcastEpisode::GetState);
+        controller->setLastPlayed(QDateTime());
+        refreshEpisode(controller);
+        return;
+    }
+
+    int row = rowOfEpisode(dbid);
+    if (row == -1) {
+        return;
+    }
+
+    m_episodes[row].forgetDownload();
+    updateEpisode(row);
+}
+
+void PodcastEpisodesModel::deleteDownload(int dbid)
+{
+    PodcastEpisode *controller = m_controllers.value(dbid);
+    if (controller != 0) {
+        controller->deleteDownload();
+        refreshEpisode(controller);
+        return;
+    }
+
+    int row = rowOfEpisode(dbid);
+    if (row == -1) {
+        return;
+    }
+
+    m_episodes[row].deleteDownload();
+    updateEpisode(row);
+}
+
+void PodcastEpisodesModel::markAllAsPlayed()
+{
+    fetchAll();
+
+    QList<int> unplayed;
+    foreach(const PodcastEpisodeData &episode, m_episodes) {
+        if (episode.isDownloaded() &&
+            PodcastEpisode::episodeStatus(episode) == PodcastEpisode::DownloadedStatus) {
+            unplayed << episode.dbid;
+        }
+    }
+
+    foreach(int dbid, unplayed) {
+        setPlayed(dbid, true);
+    }
+}
+
+void PodcastEpisodesModel::deleteAllDownloads()
+{
+    fetchAll();
+
+    QList<int> downloaded;
+    foreach(const PodcastEpisodeData &episode, m_episodes) {
+        if (episode.isDownloaded()) {
+            downloaded << episode.dbid;
+        }
+    }
+
+    foreach(int dbid, downloaded) {
+        deleteDownload(dbid);
+    }
 }
 
 void PodcastEpisodesModel::removeAll()
 {
     qDebug()  << "Removing all episodes from the model.";
-    foreach(PodcastEpisode *episode, m_episodes) {
-        episode->deleteDownload();
-        delete episode;
+    fetchAll();
+
+    foreach(PodcastEpisode *controller, m_controllers) {
+        disconnect(controller, 0, this, 0);
+        controller->cancelCurrentDownload();
+        delete controller;
+    }
+    m_controllers.clear();
+
+    for (int i=0; i<m_episodes.size(); i++) {
+        m_episodes[i].deleteDownload();
     }
 
     beginRemoveRows(QModelIndex(), 0, m_episodes.size()-1);
     m_episodes.clear();
+    m_rows.clear();
+    m_rowsDirty = false;
     endRemoveRows();
 }
 
-QHash<int, QByteArray> PodcastEpisodesModel::roleNames() const
+/**
+ * The memory the episodes of the model take, in bytes.
+ */
+int PodcastEpisodesModel::memoryUsage() const
 {
-    return m_roles;
+    int bytes = m_episodes.capacity() * sizeof(PodcastEpisodeData);
+    foreach(const PodcastEpisodeData &episode, m_episodes) {
+        int chars = episode.title.size() + episode.downloadLink.size() +
+                episode.playFilename.size() + episode.preview.size() + episode.duration.size() +
+                episode.publishedText.size() + episode.lastPlayedText.size();
+        bytes += chars * sizeof(QChar);
+    }
+
+    return bytes;
 }
 
-QList<PodcastEpisode *> PodcastEpisodesModel::unplayedEpisodes()
+/**
+ * True if an episode of the model is queued, being downloaded or having
+ * its stream resolved, so that the download queue or the UI refers to it.
+ */
+bool PodcastEpisodesModel::hasActiveEpisodes() const
 {
-    QList<PodcastEpisode *> episodes;
-
-    if (m_episodes.isEmpty()) {
-        return episodes;
-    }
-
-    for (int i=0; i<m_episodes.length(); i++) {
-        PodcastEpisode *episode = m_episodes.at(i);
-        if (!episode->playFilename().isEmpty() &&
-            episode->episodeState() == "downloaded") {
-            episodes << episode;
+    foreach(PodcastEpisode *controller, m_controllers) {
+        if (isActiveController(controller)) {
+            return true;
         }
     }
 
-    return episodes;
+    return false;
 }
 
-QList<PodcastEpisode *> PodcastEpisodesModel::episodes()
+QHash<int, QByteArray> PodcastEpisodesModel::roleNames() const
 {
-    return m_episodes;
+    return m_roles;
 }
 
-void PodcastEpisodesModel::cleanOldEpisodes(int keepNumEpisodes, bool keepUnplayed)
+/**
+ * The DB ids of the episodes that are being downloaded or streamed.
+ */
+QList<int> PodcastEpisodesModel::activeEpisodeIds() const
 {
-    if (keepNumEpisodes == 0) {
-        return;
+    QList<int> dbids;
+    foreach(PodcastEpisode *controller, m_controllers) {
+        if (isActiveController(controller)) {
+            dbids << controller->dbid();
+        }
     }
 
-    QList<PodcastEpisode *> episodesToDel;
-    for (int i=keepNumEpisodes; i<m_episodes.length(); i++) {
-        PodcastEpisode *episode = m_episodes.at(i);
+    return dbids;
+}
 
-        // If we want to keep unplayed episodes...
-        if (keepUnplayed) {
-            // Check if the episode filename is not empty (we have an episode)
-            // and that the last played is not set, then we know we have an unplayed and
-            // downloaded episode that we want to keep.
-            if (!episode->playFilename().isEmpty() &&
-                !episode->lastPlayed().isValid()) {
-                continue;
-            }
+/**
+ * Removes the rows of the episodes with the DB ids, which have already been
+ * deleted from the DB. The ids that are not loaded are skipped.
+ */
+void PodcastEpisodesModel::removeEpisodeRows(const QList<int> &dbids)
+{
+    QList<int> rows;
+    foreach(int dbid, dbids) {
+        int row = rowOfEpisode(dbid);
+        if (row != -1) {
+            rows << row;
         }
+    }
 
-        // Otherwise, delete the episode and the download
-        if (!episode->playFilename().isEmpty()) {
-            episode->deleteDownload();
+    // From the last row, so that the rows before stay where they are. Rows
+    // next to each other are removed together.
+    qSort(rows);
+    int last = rows.size() - 1;
+    while (last >= 0) {
+        int first = last;
+        while (first > 0 && rows.at(first - 1) == rows.at(first) - 1) {
+            first--;
         }
 
-        episodesToDel << episode;
-    }
+        beginRemoveRows(QModelIndex(), rows.at(first), rows.at(last));
+        for (int row=rows.at(first); row<=rows.at(last); row++) {
+            delete m_controllers.take(m_episodes.at(row).dbid);
+        }
+        m_episodes.remove(rows.at(first), last - first + 1);
+        m_rowsDirty = true;
+        endRemoveRows();
 
-    foreach(PodcastEpisode *episode, episodesToDel) {
-        delEpisode(episode);
+        last = first - 1;
     }
 }
-
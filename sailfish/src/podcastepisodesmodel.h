@@ -19,12 +19,20 @@
 #define PODCASTEPISODESMODEL_H
 
 #include <QAbstractListModel>
+#include <QHash>
 #include <QList>
+#include <QVector>
 
 #include "podcastepisode.h"
 #include "podcastsqlmanager.h"
 
 class QDateTime;
+
+/**
+ * The episodes of a channel, newest first. The episodes are kept as
+ * PodcastEpisodeData values. An episode that is downloaded or streamed gets
+ * a PodcastEpisode for it, its controller, for as long as that goes on.
+ */
 class PodcastEpisodesModel : public QAbstractListModel
 {
     Q_OBJECT
@@ -34,10 +42,12 @@ public:
         DbidRole,
         PubRole,
         DescriptionRole,
-        StateRole,
+        StatusRole,
         TotalDownloadRole,
         AlreadyDownloaded,
-        LastTimePlayedRole
+        LastTimePlayedRole,
+        PreviewRole,
+        DownloadStatusRole
     };
 
     PodcastEpisodesModel(int channelId, QObject *parent = 0);
@@ -48,28 +58,39 @@ public:
 
     int rowCount(const QModelIndex & parent = QModelIndex()) const;
     QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
+    bool canFetchMore(const QModelIndex & parent) const;
+    void fetchMore(const QModelIndex & parent);
+    void fetchAll();
 
-    void addEpisode(PodcastEpisode *episode);
-    void addEpisodes(QList<PodcastEpisode *> episode);
+    void insertSavedEpisodes(QList<PodcastEpisode *> episodes);
 
-    void delEpisode(PodcastEpisode *episode);
-    void delEpisode(int index, PodcastEpisode *episode);
-
-    PodcastEpisode *episode(int index);
+    const PodcastEpisodeData *episode(int index) const;
+    const PodcastEpisodeData *episodeByDbId(int dbid);
+    PodcastEpisode *episodeController(int dbid);
 
     PodcastEpisodesModel * episodesModel(int channelId);
     void refreshModel();
 
     void refreshEpisode(PodcastEpisode *episode);
 
-    QList<PodcastEpisode *> episodes();
+    void setPlayed(int dbid, bool played);
+    void forgetDownload(int dbid);
+    void deleteDownload(int dbid);
+    void markAllAsPlayed();
+    void deleteAllDownloads();
+
     QList<PodcastEpisode *> undownloadedEpisodes(int maxUndownloadedEpisodes);
-    QList<PodcastEpisode *> unplayedEpisodes();
 
-    void cleanOldEpisodes(int keepNumEpisodes, bool keepUnplayed);
+    QList<int> activeEpisodeIds() const;
+    void removeEpisodeRows(const QList<int> &dbids);
     void removeAll();
+
+    int memoryUsage() const;
+    bool hasActiveEpisodes() const;
     QHash<int, QByteArray> roleNames() const;
 
+    static bool isNewerEpisode(const PodcastEpisodeData &episode, const PodcastEpisodeData &other);
+
 signals:
     void episodeBeingDeleted(PodcastEpisode *episode);
 
@@ -77,12 +98,27 @@ public slots:
 
 private slots:
     void onEpisodeChanged();
+    void onStreamingUrlResolved();
 
 private:
+    int rowOfEpisode(int dbid);
+    void updateRows();
+    void updateEpisode(int row);
+    void syncController(PodcastEpisode *controller);
+    void releaseController(PodcastEpisode *controller);
+
     PodcastSQLManager      *m_sqlmanager;
-    QList<PodcastEpisode *> m_episodes;
+    QVector<PodcastEpisodeData> m_episodes;
     int m_channelId;
-    QDateTime               m_latestEpisodeTimestamp;
+    bool                    m_allFetched;
+
+    // The row of each episode by its DB id. Appending keeps it up to date,
+    // inserting and removing rows before others marks it for a rebuild.
+    QHash<int, int>         m_rows;
+    bool                    m_rowsDirty;
+
+    // The controllers of the episodes being downloaded or streamed, by DB id.
+    QHash<int, PodcastEpisode *> m_controllers;
     QHash<int, QByteArray>  m_roles;
 
 };
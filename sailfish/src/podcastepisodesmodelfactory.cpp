@@ -16,15 +16,44 @@
  * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <QObject>
+#include <QDBusConnection>
+#include <QtAlgorithms>
+#include <QtDebug>
+
+#include <MGConfItem>
 
 #include "podcastsqlmanager.h"
 #include "podcastepisodesmodelfactory.h"
 
+/**
+ * The order of the models, for the episodes of a refresh.
+ */
+static bool isNewerEpisode(PodcastEpisode *episode, PodcastEpisode *other)
+{
+    return PodcastEpisodesModel::isNewerEpisode(episode->data(), other->data());
+}
+
+// The memory the cached episode models may take, in megabytes, unless
+// set in the configuration.
+static const int DefaultMemoryBudgetMB = 8;
+
 PodcastEpisodesModelFactory * PodcastEpisodesModelFactory::instance = 0;
 
-PodcastEpisodesModelFactory::PodcastEpisodesModelFactory()
+PodcastEpisodesModelFactory::PodcastEpisodesModelFactory() :
+    QObject(),
+    m_memoryBudget(DefaultMemoryBudgetMB * 1024 * 1024)
 {
     m_sqlmanager = PodcastSQLManagerFactory::sqlmanager();
+
+    m_memoryBudgetConf = new MGConfItem("/apps/ControlPanel/Podcatcher/episode_cache_mb", this);
+    connect(m_memoryBudgetConf, SIGNAL(valueChanged()),
+            this, SLOT(onMemoryBudgetChanged()));
+    onMemoryBudgetChanged();
+
+    // MCE tells when the device is running out of memory.
+    QDBusConnection::systemBus().connect("com.nokia.mce", "/com/nokia/mce/signal",
+                                         "com.nokia.mce.signal", "sig_memory_level_ind",
+                                         this, SLOT(onMemoryLevelChanged(QString)));
 }
 
 PodcastEpisodesModel * PodcastEpisodesModelFactory::episodesModel(int channelId)
@@ -34,22 +63,111 @@ PodcastEpisodesModel * PodcastEpisodesModelFactory::episodesModel(int channelId)
        return 0;
     }
 
-    // If the model is already fetched from the DB, just rturn it.
+    // If the model is already fetched from the DB, just return it.
     // Otherwise fetch data from DB an create the model.
     if (m_modelCache.contains(channelId)) {
+        m_recentlyUsed.removeOne(channelId);
+        m_recentlyUsed.append(channelId);
+
+        // The model may have grown since it was last asked for.
+        evictModels(m_memoryBudget, channelId);
         return m_modelCache.value(channelId);
     }
 
+    // Only the first page of episodes is read now, the view fetches the rest when scrolled.
     PodcastEpisodesModel *model = new PodcastEpisodesModel(channelId);
-    QList<PodcastEpisode *> episodes = m_sqlmanager->episodesInDB(channelId);
-    model->addEpisodes(episodes);
+    model->fetchMore(QModelIndex());
 
     // Cache the constructed model
     m_modelCache.insert(channelId, model);
+    m_recentlyUsed.append(channelId);
+    evictModels(m_memoryBudget, channelId);
 
     return model;
 }
 
+/**
+ * Saves the new episodes of a refresh to the DB. An episode is new if its
+ * download link is neither in the DB nor deleted from it by the cleanup, so
+ * episodes a feed adds below the newest one are saved too. Episodes without
+ * a link are new only if they are newer than the newest one in the DB. A
+ * model of the channel that is in the cache gets the new episodes, the model
+ * is not created if it is not. Takes the ownership of the episodes, returns
+ * how many were saved.
+ */
+int PodcastEpisodesModelFactory::saveNewEpisodes(int channelId, QList<PodcastEpisode *> episodes)
+{
+    if (episodes.isEmpty()) {
+        return 0;
+    }
+
+    QDateTime dbsLatestEpisode = m_sqlmanager->latestEpisodeTimestampInDB(channelId);
+    QSet<QString> knownLinks = m_sqlmanager->episodeLinksInDB(channelId);
+    QList<PodcastEpisode *> newEpisodes;
+    foreach(PodcastEpisode *episode, episodes) {
+        const QString &link = episode->data().downloadLink;
+        bool isNew = link.isEmpty() ? (episode->pubTime() > dbsLatestEpisode) : !knownLinks.contains(link);
+        if (isNew) {
+            // Feeds sometimes list an episode twice.
+            knownLinks.insert(link);
+            episode->setChannelId(channelId);
+            newEpisodes << episode;
+        } else {
+            delete episode;
+        }
+    }
+
+    if (newEpisodes.isEmpty()) {
+        qDebug() << "No new episodes to be added to the DB.";
+        return 0;
+    }
+
+    // Feeds are not always in order. The oldest episode is saved first, so that
+    // episodes published at the same time are in the same order in the DB.
+    qStableSort(newEpisodes.begin(), newEpisodes.end(), isNewerEpisode);
+    QList<PodcastEpisode *> oldestFirst;
+    oldestFirst.reserve(newEpisodes.size());
+    for (int i=newEpisodes.size()-1; i>=0; i--) {
+        oldestFirst << newEpisodes.at(i);
+    }
+
+    qDebug() << "Adding new episodes to DB: " << newEpisodes.size();
+    m_sqlmanager->podcastEpisodesToDB(oldestFirst, channelId);
+
+    QList<PodcastEpisode *> savedEpisodes;
+    QList<PodcastEpisodeSummary> summaries;
+    foreach(PodcastEpisode *episode, newEpisodes) {
+        if (episode->dbid() < 1) {
+            delete episode;     // Not saved.
+            continue;
+        }
+
+        savedEpisodes << episode;
+
+        PodcastEpisodeSummary summary;
+        summary.episodeId = episode->dbid();
+        summary.channelId = channelId;
+        summary.title = episode->title();
+        summary.preview = episode->preview();
+        summary.published = episode->pubTime();
+        summaries << summary;
+    }
+
+    int saved = savedEpisodes.size();
+    PodcastEpisodesModel *model = m_modelCache.value(channelId);
+    if (model != 0) {
+        model->insertSavedEpisodes(savedEpisodes);
+    } else {
+        qDeleteAll(savedEpisodes);
+    }
+
+    if (!summaries.isEmpty()) {
+        emit newEpisodesSaved(summaries);
+    }
+
+    return saved;
+}
+
 PodcastEpisodesModelFactory * PodcastEpisodesModelFactory::episodesFactory()
 {
     if (instance == 0) {
@@ -58,9 +176,123 @@ PodcastEpisodesModelFactory * PodcastEpisodesModelFactory::episodesFactory()
     return instance;
 }
 
+/**
+ * The model of the channel if it is in the cache, otherwise 0. Unlike
+ * episodesModel(), does not load the model.
+ */
+PodcastEpisodesModel * PodcastEpisodesModelFactory::cachedModel(int channelId) const
+{
+    return m_modelCache.value(channelId, 0);
+}
+
 void PodcastEpisodesModelFactory::removeFromCache(int channelId)
 {
     if (m_modelCache.contains(channelId)) {
         m_modelCache.remove(channelId);
     }
+    m_recentlyUsed.removeOne(channelId);
+    m_pinCounts.remove(channelId);
+}
+
+/**
+ * A pinned model stays in the cache until it is unpinned as many times.
+ * Pin the models that are used outside of the factory, like the model
+ * shown in the view or one that is worked on in another thread.
+ */
+void PodcastEpisodesModelFactory::pinModel(int channelId)
+{
+    m_pinCounts[channelId]++;
+}
+
+void PodcastEpisodesModelFactory::unpinModel(int channelId)
+{
+    QHash<int, int>::iterator pins = m_pinCounts.find(channelId);
+    if (pins == m_pinCounts.end()) {
+        return;
+    }
+
+    if (--pins.value() == 0) {
+        m_pinCounts.erase(pins);
+    }
+}
+
+void PodcastEpisodesModelFactory::setMemoryBudget(int bytes)
+{
+    m_memoryBudget = bytes;
+    evictModels(m_memoryBudget);
+}
+
+int PodcastEpisodesModelFactory::memoryBudget() const
+{
+    return m_memoryBudget;
+}
+
+/**
+ * Deletes all the models that are not in use. They are read from the DB
+ * again when asked for.
+ */
+void PodcastEpisodesModelFactory::dropCachedModels()
+{
+    evictModels(0);
+}
+
+void PodcastEpisodesModelFactory::onMemoryBudgetChanged()
+{
+    int budgetMB = m_memoryBudgetConf->value(DefaultMemoryBudgetMB).toInt();
+    if (budgetMB < 1) {
+        budgetMB = DefaultMemoryBudgetMB;
+    }
+
+    qDebug() << "Setting changed: episode cache size (MB):" << budgetMB;
+    setMemoryBudget(budgetMB * 1024 * 1024);
+}
+
+void PodcastEpisodesModelFactory::onMemoryLevelChanged(const QString &level)
+{
+    qDebug() << "Memory level changed:" << level;
+
+    // "warning" or "critical".
+    if (level != "normal") {
+        dropCachedModels();
+    }
+}
+
+bool PodcastEpisodesModelFactory::isEvictable(int channelId, PodcastEpisodesModel *model) const
+{
+    // The download queue points to the episodes being downloaded, and the
+    // UI to an episode whose stream is being resolved.
+    return !m_pinCounts.contains(channelId) && !model->hasActiveEpisodes();
+}
+
+/**
+ * Deletes the least recently used models until the cached models fit in
+ * the budget, or only models in use are left. The model of keepChannelId
+ * is kept, as the caller is about to use it.
+ */
+void PodcastEpisodesModelFactory::evictModels(int budget, int keepChannelId)
+{
+    int memoryUsage = 0;
+    foreach(PodcastEpisodesModel *model, m_modelCache) {
+        memoryUsage += model->memoryUsage();
+    }
+
+    QList<int> recentlyUsed = m_recentlyUsed;
+    foreach(int channelId, recentlyUsed) {
+        if (memoryUsage <= budget) {
+            break;
+        }
+
+        PodcastEpisodesModel *model = m_modelCache.value(channelId);
+        if (channelId == keepChannelId || !isEvictable(channelId, model)) {
+            continue;
+        }
+
+        qDebug() << "Dropping the cached episodes of channel" << channelId;
+        memoryUsage -= model->memoryUsage();
+        m_modelCache.remove(channelId);
+        m_recentlyUsed.removeOne(channelId);
+
+        // A view may still refer to the model until the event loop runs.
+        model->deleteLater();
+    }
 }
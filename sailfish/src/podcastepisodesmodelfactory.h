@@ -18,27 +18,71 @@
 #ifndef PODCASTEPISODESMODELFACTORY_H
 #define PODCASTEPISODESMODELFACTORY_H
 
+#include <QObject>
+#include <QHash>
 #include <QMap>
 #include <QList>
 
 #include "podcastepisodesmodel.h"
 #include "podcastsqlmanager.h"
 
-class PodcastEpisodesModelFactory
+class MGConfItem;
+
+/**
+ * Creates the episode models of the channels and keeps the recently used
+ * ones in a cache. When the models take more memory than the budget, the
+ * least recently used ones are deleted. Models that are pinned, like the one
+ * shown in the view, and models with episodes that are queued, downloading
+ * or having their stream resolved are never deleted, as their episodes are
+ * referenced from elsewhere.
+ */
+class PodcastEpisodesModelFactory : public QObject
 {
+    Q_OBJECT
 public:
     static PodcastEpisodesModelFactory* episodesFactory();
     PodcastEpisodesModel * episodesModel(int channelId);
+    PodcastEpisodesModel * cachedModel(int channelId) const;
+
+    int saveNewEpisodes(int channelId, QList<PodcastEpisode *> episodes);
 
     void removeFromCache(int channelId);
 
+    void pinModel(int channelId);
+    void unpinModel(int channelId);
+
+    void setMemoryBudget(int bytes);
+    int memoryBudget() const;
+
+signals:
+    /**
+     * New episodes of a channel were saved to the DB, newest first. The
+     * channel titles are not set.
+     */
+    void newEpisodesSaved(const QList<PodcastEpisodeSummary> &episodes);
+
+public slots:
+    void dropCachedModels();
+
+private slots:
+    void onMemoryBudgetChanged();
+    void onMemoryLevelChanged(const QString &level);
+
 private:
     PodcastEpisodesModelFactory();
 
+    bool isEvictable(int channelId, PodcastEpisodesModel *model) const;
+    void evictModels(int budget, int keepChannelId = 0);
+
     static PodcastEpisodesModelFactory *instance;
     PodcastSQLManager *m_sqlmanager;
     QMap<int, PodcastEpisodesModel *> m_modelCache;
 
+    // Channel ids of the cached models, the least recently used first.
+    QList<int> m_recentlyUsed;
+    QHash<int, int> m_pinCounts;
+    int m_memoryBudget;
+    MGConfItem *m_memoryBudgetConf;
 };
 
 #endif // PODCASTEPISODESMODELFACTORY_H
@@ -0,0 +1,138 @@
+/**
+ * This file is part of Podcatcher for Sailfish OS.
+ * Author: Johan Paul (johan.paul@gmail.com)
+ *
+ * Podcatcher for Sailfish OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Podcatcher for Sailfish OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <QImageReader>
+
+#include <QtDebug>
+
+#include "podcastimageprovider.h"
+#include "podcastlogocache.h"
+
+// Decoded logos kept in memory, in kilobytes. A 110 px logo is about 50 kB.
+static const int ImageCacheSize = 8 * 1024;
+// Decoding is I/O and CPU bound, a couple of threads is enough.
+static const int DecoderThreads = 2;
+
+QCache<QString, QImage> PodcastImageProvider::m_imageCache(ImageCacheSize);
+QMutex PodcastImageProvider::m_imageCacheMutex;
+
+PodcastImageProvider::PodcastImageProvider()
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+    : QQuickAsyncImageProvider()
+#else
+    : QQuickImageProvider(QQuickImageProvider::Image, QQuickImageProvider::ForceAsynchronousImageLoading)
+#endif
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+    m_threadPool.setMaxThreadCount(DecoderThreads);
+#endif
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+QQuickImageResponse * PodcastImageProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
+{
+    PodcastImageResponse *response = new PodcastImageResponse(id, requestedSize);
+    m_threadPool.start(response);
+    return response;
+}
+#else
+QImage PodcastImageProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    // ForceAsynchronousImageLoading: this is already called in a loader thread.
+    QImage image = logoImage(id, requestedSize);
+    if (size != 0) {
+        *size = image.size();
+    }
+
+    return image;
+}
+#endif
+
+/**
+ * Returns the logo for an id of the form <logo key>/<size>. The requested
+ * size, if the QML Image sets a sourceSize, overrides the size in the id.
+ */
+QImage PodcastImageProvider::logoImage(const QString &id, const QSize &requestedSize)
+{
+    QString logoKey = id.section('/', 0, 0);
+    int size = id.section('/', 1, 1).toInt();
+    if (requestedSize.width() > 0 || requestedSize.height() > 0) {
+        size = qMax(requestedSize.width(), requestedSize.height());
+    }
+
+    QString cacheKey = QString("%1/%2").arg(logoKey).arg(size);
+
+    m_imageCacheMutex.lock();
+    QImage *cachedImage = m_imageCache.object(cacheKey);
+    if (cachedImage != 0) {
+        QImage image = *cachedImage;
+        m_imageCacheMutex.unlock();
+        return image;
+    }
+    m_imageCacheMutex.unlock();
+
+    QString filename = PodcastLogoCache::logoFile(logoKey, size);
+    if (filename.isEmpty()) {
+        qWarning() << "No cached logo for" << id;
+        return QImage();
+    }
+
+    QImageReader reader(filename);
+
+    // A thumbnail of the exact size is used as it is. Anything larger is
+    // decoded straight to the size it is shown in.
+    QSize imageSize = reader.size();
+    if (size > 0 &&
+        imageSize.isValid() &&
+        (imageSize.width() > size || imageSize.height() > size)) {
+        imageSize.scale(size, size, Qt::KeepAspectRatio);
+        reader.setScaledSize(imageSize);
+    }
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        qWarning() << "Could not decode logo" << filename << ":" << reader.errorString();
+        return image;
+    }
+
+    m_imageCacheMutex.lock();
+    m_imageCache.insert(cacheKey, new QImage(image), qMax(1, image.byteCount() / 1024));
+    m_imageCacheMutex.unlock();
+
+    return image;
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+PodcastImageResponse::PodcastImageResponse(const QString &id, const QSize &requestedSize) :
+    m_id(id),
+    m_requestedSize(requestedSize)
+{
+    // QML deletes the response when it is done with it.
+    setAutoDelete(false);
+}
+
+QQuickTextureFactory * PodcastImageResponse::textureFactory() const
+{
+    return QQuickTextureFactory::textureFactoryForImage(m_image);
+}
+
+void PodcastImageResponse::run()
+{
+    m_image = PodcastImageProvider::logoImage(m_id, m_requestedSize);
+    emit finished();
+}
+#endif
@@ -0,0 +1,79 @@
+/**
+ * This file is part of Podcatcher for Sailfish OS.
+ * Author: Johan Paul (johan.paul@gmail.com)
+ *
+ * Podcatcher for Sailfish OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Podcatcher for Sailfish OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PODCASTIMAGEPROVIDER_H
+#define PODCASTIMAGEPROVIDER_H
+
+#include <QtGlobal>
+#include <QImage>
+#include <QCache>
+#include <QMutex>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QQuickImageProvider>
+
+/**
+ * Serves cached channel logos to QML as image://podcatcher/<logo key>/<size>.
+ *
+ * The logos are read from the thumbnails in PodcastLogoCache and decoded in
+ * a thread pool, never on the render thread. Decoded images are kept in a
+ * bounded LRU cache, so that scrolling the channel list back and forth does
+ * not decode them again.
+ */
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+class PodcastImageProvider : public QQuickAsyncImageProvider
+#else
+class PodcastImageProvider : public QQuickImageProvider
+#endif
+{
+public:
+    PodcastImageProvider();
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize);
+#else
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize);
+#endif
+
+    static QImage logoImage(const QString &id, const QSize &requestedSize);
+
+private:
+    static QCache<QString, QImage> m_imageCache;
+    static QMutex m_imageCacheMutex;
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+    QThreadPool m_threadPool;
+#endif
+};
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+class PodcastImageResponse : public QQuickImageResponse, public QRunnable
+{
+public:
+    PodcastImageResponse(const QString &id, const QSize &requestedSize);
+
+    QQuickTextureFactory *textureFactory() const;
+    void run();
+
+private:
+    QString m_id;
+    QSize m_requestedSize;
+    QImage m_image;
+};
+#endif
+
+#endif // PODCASTIMAGEPROVIDER_H
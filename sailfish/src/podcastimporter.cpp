@@ -0,0 +1,240 @@
+/**
+ * This file is part of Podcatcher for Sailfish OS.
+ * Author: Johan Paul (johan.paul@gmail.com)
+ *
+ * Podcatcher for Sailfish OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Podcatcher for Sailfish OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <QNetworkRequest>
+#include <QNetworkReply>
+
+#include <QtDebug>
+
+#include "podcastimporter.h"
+#include "podcastmanager.h"
+#include "podcastnetworkmanager.h"
+#include "podcastrssparser.h"
+#include "podcastsqlmanager.h"
+
+// Enough to keep the connection pool busy without flooding it with hundreds of requests.
+static const int MaxParallelFeedRequests = 4;
+// Channels written to the DB in one transaction.
+static const int ImportBatchSize = 50;
+static const int MaxFeedRedirects = 5;
+
+PodcastImporter::PodcastImporter(QObject *parent) :
+    QObject(parent),
+    m_network(PodcastNetworkManager::networkManager()),
+    m_sqlmanager(PodcastSQLManagerFactory::sqlmanager()),
+    m_autoDownloadOn(false),
+    m_total(0),
+    m_done(0),
+    m_imported(0),
+    m_failed(0)
+{
+}
+
+PodcastImporter::~PodcastImporter()
+{
+    foreach(PodcastChannel *channel, m_parsedChannels) {
+        qDeleteAll(m_parsedEpisodes.value(channel));
+        delete channel;
+    }
+}
+
+void PodcastImporter::importSubscriptions(const QList<QString> &urls, const QSet<QString> &subscribedUrls, bool autoDownloadOn)
+{
+    m_autoDownloadOn = autoDownloadOn;
+
+    int queued = 0;
+    foreach(QString url, urls) {
+        QUrl feedUrl(url.trimmed());
+        if (!feedUrl.isValid() || feedUrl.scheme().isEmpty()) {
+            qDebug() << "Not importing invalid subscription URL:" << url;
+            continue;
+        }
+
+        QString requestKey = PodcastNetworkManager::normalisedRequestUrl(feedUrl);
+        if (subscribedUrls.contains(requestKey) || m_queuedUrls.contains(requestKey)) {
+            qDebug() << "Already subscribed to" << url << ". Not importing it again.";
+            continue;
+        }
+
+        m_queuedUrls.insert(requestKey);
+        m_pendingUrls.append(feedUrl);
+        queued++;
+    }
+
+    qDebug() << "Importing" << queued << "new subscriptions out of" << urls.size();
+
+    if (queued == 0 && !isImporting()) {
+        emit importFinished(0, 0);
+        return;
+    }
+
+    m_total += queued;
+    emit importProgress(m_done, m_total);
+
+    fetchNextFeeds();
+}
+
+bool PodcastImporter::isImporting() const
+{
+    return m_done < m_total;
+}
+
+void PodcastImporter::fetchNextFeeds()
+{
+    while (m_feedFetches.size() < MaxParallelFeedRequests &&
+           !m_pendingUrls.isEmpty()) {
+        QUrl url = m_pendingUrls.takeFirst();
+        fetchFeed(url, url, 0);
+    }
+}
+
+void PodcastImporter::fetchFeed(const QUrl &url, const QUrl &subscriptionUrl, int redirects)
+{
+    QNetworkRequest request = m_network->request(url, PodcastNetworkManager::FeedRequest);
+
+    bool attached = false;
+    QNetworkReply *reply = m_network->coalescedGet(request, &attached);
+    if (attached) {
+        // Someone else (e.g. the user adding the same podcast by hand) is fetching
+        // this feed already and will subscribe to it.
+        qDebug() << "Feed" << url << "is already being fetched. Not importing it.";
+        feedDone(true);
+        return;
+    }
+
+    FeedFetch fetch;
+    fetch.subscriptionUrl = subscriptionUrl;
+    fetch.redirects = redirects;
+    m_feedFetches.insert(reply, fetch);
+
+    connect(reply, SIGNAL(finished()),
+            this, SLOT(onFeedRequestCompleted()));
+}
+
+void PodcastImporter::onFeedRequestCompleted()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (reply == 0 || !m_feedFetches.contains(reply)) {
+        return;
+    }
+
+    FeedFetch fetch = m_feedFetches.take(reply);
+    reply->deleteLater();
+
+    QString redirectedUrl = PodcastManager::redirectedRequest(reply);
+    if (!redirectedUrl.isEmpty()) {
+        if (fetch.redirects < MaxFeedRedirects) {
+            fetchFeed(QUrl(redirectedUrl), fetch.subscriptionUrl, fetch.redirects + 1);
+        } else {
+            qWarning() << "Too many redirects when importing" << reply->url();
+            feedDone(false);
+        }
+        return;
+    }
+
+    if (reply->error() != QNetworkReply::NoError) {
+        qWarning() << "Could not import" << reply->url() << ":" << reply->errorString();
+        feedDone(false);
+        return;
+    }
+
+    QByteArray data = m_network->readAll(reply);
+
+    PodcastChannel *channel = new PodcastChannel;
+    // Redirects can be temporary, and importing the same list again
+    // compares the URLs of the list with the subscribed ones.
+    channel->setUrl(fetch.subscriptionUrl.toString());
+    channel->setAutoDownloadOn(m_autoDownloadOn);
+
+    if (data.isEmpty() ||
+        !PodcastRSSParser::populateChannelFromChannelXML(channel, data)) {
+        qWarning() << "Podcast feed is not valid. Not importing" << reply->url();
+        delete channel;
+        feedDone(false);
+        return;
+    }
+
+    // A channel without parseable episodes is still imported. It gets its episodes on the next refresh.
+    QList<PodcastEpisode *> episodes;
+    if (!PodcastRSSParser::populateEpisodesFromChannelXML(&episodes, data)) {
+        qWarning() << "Could not parse the episodes of" << reply->url();
+        qDeleteAll(episodes);
+        episodes.clear();
+    }
+
+    m_parsedChannels.append(channel);
+    m_parsedEpisodes.insert(channel, episodes);
+
+    feedDone(true);
+}
+
+void PodcastImporter::feedDone(bool ok)
+{
+    m_done++;
+    if (!ok) {
+        m_failed++;
+    }
+
+    emit importProgress(m_done, m_total);
+
+    if (m_parsedChannels.size() >= ImportBatchSize ||
+        m_done == m_total) {
+        flushImportedChannels();
+    }
+
+    if (m_done == m_total) {
+        qDebug() << "Import finished. Imported:" << m_imported << "failed:" << m_failed;
+        emit importFinished(m_imported, m_failed);
+
+        m_queuedUrls.clear();
+        m_total = 0;
+        m_done = 0;
+        m_imported = 0;
+        m_failed = 0;
+        return;
+    }
+
+    fetchNextFeeds();
+}
+
+void PodcastImporter::flushImportedChannels()
+{
+    if (m_parsedChannels.isEmpty()) {
+        return;
+    }
+
+    QList<PodcastChannel *> savedChannels = m_sqlmanager->importChannelsToDB(m_parsedChannels,
+                                                                             m_parsedEpisodes);
+
+    // The episodes are now in the DB, and the episode models read them from there when needed.
+    foreach(PodcastChannel *channel, m_parsedChannels) {
+        qDeleteAll(m_parsedEpisodes.value(channel));
+        if (!savedChannels.contains(channel)) {
+            delete channel;
+        }
+    }
+
+    m_failed += m_parsedChannels.size() - savedChannels.size();
+    m_imported += savedChannels.size();
+
+    m_parsedChannels.clear();
+    m_parsedEpisodes.clear();
+
+    if (!savedChannels.isEmpty()) {
+        emit channelsImported(savedChannels);
+    }
+}
@@ -0,0 +1,97 @@
+/**
+ * This file is part of Podcatcher for Sailfish OS.
+ * Author: Johan Paul (johan.paul@gmail.com)
+ *
+ * Podcatcher for Sailfish OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Podcatcher for Sailfish OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PODCASTIMPORTER_H
+#define PODCASTIMPORTER_H
+
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QUrl>
+
+#include "podcastchannel.h"
+#include "podcastepisode.h"
+
+class QNetworkReply;
+class PodcastNetworkManager;
+class PodcastSQLManager;
+
+/**
+ * Imports a list of subscriptions (from an OPML file or gPodder.net) in bulk.
+ *
+ * Feeds are fetched a few at a time. Each parsed channel and its episodes are
+ * collected and written to the DB in large batches, one transaction per batch,
+ * instead of one transaction per channel and per episode list.
+ */
+class PodcastImporter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PodcastImporter(QObject *parent = 0);
+    ~PodcastImporter();
+
+    /**
+     * Queues the given feed URLs for importing. URLs that are already
+     * subscribed to (normalised URLs in subscribedUrls), or are already
+     * being imported, are skipped.
+     */
+    void importSubscriptions(const QList<QString> &urls, const QSet<QString> &subscribedUrls, bool autoDownloadOn);
+
+    bool isImporting() const;
+
+signals:
+    void importProgress(int done, int total);
+
+    // Channels (with DB ids) that were just saved to the DB in one batch.
+    void channelsImported(QList<PodcastChannel *> channels);
+    void importFinished(int imported, int failed);
+
+private slots:
+    void onFeedRequestCompleted();
+
+private:
+    void fetchNextFeeds();
+    void fetchFeed(const QUrl &url, const QUrl &subscriptionUrl, int redirects);
+    void feedDone(bool ok);
+    void flushImportedChannels();
+
+    PodcastNetworkManager *m_network;
+    PodcastSQLManager *m_sqlmanager;
+
+    QList<QUrl> m_pendingUrls;
+    QSet<QString> m_queuedUrls;                       // Normalised URLs queued in this import.
+
+    // A feed request in flight. The channel is saved with the URL it was
+    // subscribed with, not the one it was redirected to.
+    struct FeedFetch {
+        QUrl subscriptionUrl;
+        int redirects;
+    };
+    QHash<QNetworkReply *, FeedFetch> m_feedFetches;
+
+    QList<PodcastChannel *> m_parsedChannels;
+    QHash<PodcastChannel *, QList<PodcastEpisode *> > m_parsedEpisodes;
+
+    bool m_autoDownloadOn;
+    int m_total;
+    int m_done;
+    int m_imported;
+    int m_failed;
+};
+
+#endif // PODCASTIMPORTER_H
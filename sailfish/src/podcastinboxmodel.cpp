@@ -0,0 +1,204 @@
+/**
+ * This file is part of Podcatcher for Sailfish OS.
+ * Author: Johan Paul (johan.paul@gmail.com)
+ *
+ * Podcatcher for Sailfish OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Podcatcher for Sailfish OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <QSet>
+#include <QtDebug>
+
+#include "podcastchannelsmodel.h"
+#include "podcastepisodesmodelfactory.h"
+#include "podcastinboxmodel.h"
+
+// The number of episodes in the inbox.
+static const int InboxSize = 100;
+
+// The same order as the episodes of a channel: newest first, and episodes
+// published at the same time in the reverse order of their DB ids.
+static bool isNewerEpisode(const PodcastEpisodeSummary &episode, const PodcastEpisodeSummary &other)
+{
+    if (episode.published != other.published) {
+        return episode.published > other.published;
+    }
+
+    return episode.episodeId > other.episodeId;
+}
+
+PodcastInboxModel::PodcastInboxModel(PodcastChannelsModel *channelsModel, QObject *parent) :
+    QAbstractListModel(parent),
+    m_channelsModel(channelsModel)
+{
+    m_roles[DbidRole] = "dbid";
+    m_roles[ChannelIdRole] = "channelId";
+    m_roles[TitleRole] = "title";
+    m_roles[ChannelTitleRole] = "channelTitle";
+    m_roles[PubRole] = "published";
+    m_roles[PreviewRole] = "descriptionPreview";
+
+    m_sqlmanager = PodcastSQLManagerFactory::sqlmanager();
+    m_episodes = newestEpisodes();
+
+    connect(PodcastEpisodesModelFactory::episodesFactory(), SIGNAL(newEpisodesSaved(QList<PodcastEpisodeSummary>)),
+            this, SLOT(onNewEpisodesSaved(QList<PodcastEpisodeSummary>)));
+    connect(m_sqlmanager, SIGNAL(episodesRemoved(QList<int>)),
+            this, SLOT(onEpisodesRemoved(QList<int>)));
+}
+
+int PodcastInboxModel::rowCount(const QModelIndex &) const
+{
+    return m_episodes.size();
+}
+
+QVariant PodcastInboxModel::data(const QModelIndex &index, int role) const
+{
+    if (index.row() < 0 || index.row() >= m_episodes.count())
+        return QVariant();
+
+    const PodcastEpisodeSummary &episode = m_episodes.at(index.row());
+
+    switch(role) {
+    case DbidRole:
+        return episode.episodeId;
+        break;
+    case ChannelIdRole:
+        return episode.channelId;
+        break;
+    case TitleRole:
+        return episode.title;
+        break;
+    case ChannelTitleRole:
+        return episode.channelTitle;
+        break;
+    case PubRole:
+        return episode.publishedText;
+        break;
+    case PreviewRole:
+        return episode.preview;
+        break;
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> PodcastInboxModel::roleNames() const
+{
+    return m_roles;
+}
+
+/**
+ * Reads the inbox from the DB again, for the changes that do not come one
+ * refresh at a time, like imported subscriptions.
+ */
+void PodcastInboxModel::reload()
+{
+    beginResetModel();
+    m_episodes = newestEpisodes();
+    endResetModel();
+}
+
+QList<PodcastEpisodeSummary> PodcastInboxModel::newestEpisodes()
+{
+    QList<PodcastEpisodeSummary> episodes = m_sqlmanager->newestEpisodesInDB(InboxSize);
+    for (int i=0; i<episodes.size(); i++) {
+        setPublishedText(episodes[i]);
+    }
+
+    return episodes;
+}
+
+/**
+ * The date is formatted once, when the episode comes to the inbox.
+ */
+void PodcastInboxModel::setPublishedText(PodcastEpisodeSummary &episode) const
+{
+    episode.publishedText = episode.published.toString(tr("dd.MM.yyyy"));
+}
+
+/**
+ * The episodes deleted from the DB, as by the cleanup, leave the inbox.
+ */
+void PodcastInboxModel::onEpisodesRemoved(const QList<int> &episodeIds)
+{
+    QSet<int> removed = episodeIds.toSet();
+    for (int row=m_episodes.size()-1; row>=0; row--) {
+        if (removed.contains(m_episodes.at(row).episodeId)) {
+            beginRemoveRows(QModelIndex(), row, row);
+            m_episodes.removeAt(row);
+            endRemoveRows();
+        }
+    }
+}
+
+void PodcastInboxModel::removeChannelEpisodes(int channelId)
+{
+    for (int row=m_episodes.size()-1; row>=0; row--) {
+        if (m_episodes.at(row).channelId == channelId) {
+            beginRemoveRows(QModelIndex(), row, row);
+            m_episodes.removeAt(row);
+            endRemoveRows();
+        }
+    }
+}
+
+/**
+ * Merges the new episodes of a refresh, newest first, into the inbox in
+ * one pass. The episodes that fall past the end of the inbox are dropped.
+ */
+void PodcastInboxModel::onNewEpisodesSaved(const QList<PodcastEpisodeSummary> &episodes)
+{
+    QList<PodcastEpisodeSummary> newEpisodes;
+    foreach(PodcastEpisodeSummary episode, episodes) {
+        if (m_episodes.size() >= InboxSize && !isNewerEpisode(episode, m_episodes.last())) {
+            break;
+        }
+
+        PodcastChannel *channel = m_channelsModel->podcastChannelById(episode.channelId);
+        if (channel != 0) {
+            episode.channelTitle = channel->title();
+        }
+        setPublishedText(episode);
+        newEpisodes << episode;
+    }
+
+    int row = 0;
+    int first = 0;
+    while (first < newEpisodes.size()) {
+        while (row < m_episodes.size() && !isNewerEpisode(newEpisodes.at(first), m_episodes.at(row))) {
+            row++;
+        }
+
+        int last = first;
+        while (last + 1 < newEpisodes.size() &&
+               (row == m_episodes.size() || isNewerEpisode(newEpisodes.at(last + 1), m_episodes.at(row)))) {
+            last++;
+        }
+
+        beginInsertRows(QModelIndex(), row, row + last - first);
+        for (int i=first; i<=last; i++) {
+            m_episodes.insert(row++, newEpisodes.at(i));
+        }
+        endInsertRows();
+
+        first = last + 1;
+    }
+
+    if (m_episodes.size() > InboxSize) {
+        beginRemoveRows(QModelIndex(), InboxSize, m_episodes.size() - 1);
+        m_episodes.erase(m_episodes.begin() + InboxSize, m_episodes.end());
+        endRemoveRows();
+    }
+
+    qDebug() << "Inbox got" << newEpisodes.size() << "new episodes";
+}
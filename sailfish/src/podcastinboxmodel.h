@@ -0,0 +1,72 @@
+/**
+ * This file is part of Podcatcher for Sailfish OS.
+ * Author: Johan Paul (johan.paul@gmail.com)
+ *
+ * Podcatcher for Sailfish OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Podcatcher for Sailfish OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PODCASTINBOXMODEL_H
+#define PODCASTINBOXMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+
+#include "podcastsqlmanager.h"
+
+class PodcastChannelsModel;
+
+/**
+ * The newest episodes of all the subscribed channels, newest first. The
+ * list is read from the DB once and then kept up to date with the episodes
+ * that the refreshes save, without creating the episode models.
+ */
+class PodcastInboxModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum InboxRoles {
+        DbidRole = Qt::UserRole + 1,
+        ChannelIdRole,
+        TitleRole,
+        ChannelTitleRole,
+        PubRole,
+        PreviewRole
+    };
+
+    explicit PodcastInboxModel(PodcastChannelsModel *channelsModel, QObject *parent = 0);
+
+    int rowCount(const QModelIndex & parent = QModelIndex()) const;
+    QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
+    QHash<int, QByteArray> roleNames() const;
+
+    void removeChannelEpisodes(int channelId);
+
+public slots:
+    void reload();
+
+private slots:
+    void onNewEpisodesSaved(const QList<PodcastEpisodeSummary> &episodes);
+    void onEpisodesRemoved(const QList<int> &episodeIds);
+
+private:
+    QList<PodcastEpisodeSummary> newestEpisodes();
+    void setPublishedText(PodcastEpisodeSummary &episode) const;
+
+    QList<PodcastEpisodeSummary> m_episodes;
+    PodcastChannelsModel *m_channelsModel;
+    PodcastSQLManager *m_sqlmanager;
+    QHash<int, QByteArray> m_roles;
+};
+
+#endif // PODCASTINBOXMODEL_H
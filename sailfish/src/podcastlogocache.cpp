@@ -0,0 +1,188 @@
+/**
+ * This file is part of Podcatcher for Sailfish OS.
+ * Author: Johan Paul (johan.paul@gmail.com)
+ *
+ * Podcatcher for Sailfish OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Podcatcher for Sailfish OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QStringList>
+#include <QUrl>
+
+#include <QtDebug>
+
+#include "podcastlogocache.h"
+#include "podcastglobals.h"
+
+QString PodcastLogoCache::ingestLogo(const QString &logoUrl, const QByteArray &logoData, const QList<int> &sizes)
+{
+    QBuffer buffer;
+    buffer.setData(logoData);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer);
+    QByteArray format = reader.format();
+    if (format.isEmpty() || !reader.canRead()) {
+        qWarning() << "Unknown image format for channel logo" << logoUrl;
+        return QString();
+    }
+
+    QString key = logoKey(logoUrl, logoData);
+
+    QDir logoDir(logoDirectory());
+    if (!logoDir.exists()) {
+        logoDir.mkpath(logoDirectory());
+    }
+
+    // Keep the original as it was downloaded, without re-encoding it.
+    QString originalSuffix = (format == "jpeg") ? QString("jpg") : QString::fromLatin1(format);
+    QFile original(logoDirectory() + key + "." + originalSuffix);
+    if (!original.exists()) {
+        if (original.open(QIODevice::WriteOnly)) {
+            original.write(logoData);
+            original.close();
+        } else {
+            qWarning() << "Could not save original channel logo:" << original.fileName();
+        }
+    }
+
+    int largestSize = 0;
+    foreach(int size, sizes) {
+        largestSize = qMax(largestSize, size);
+    }
+
+    // Decode once, at the largest size that is needed. Formats like JPEG
+    // decode straight to the smaller size without the full-size image.
+    QSize imageSize = reader.size();
+    if (largestSize > 0 &&
+        imageSize.isValid() &&
+        (imageSize.width() > largestSize || imageSize.height() > largestSize)) {
+        imageSize.scale(largestSize, largestSize, Qt::KeepAspectRatio);
+        reader.setScaledSize(imageSize);
+    }
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        qWarning() << "Could not decode channel logo" << logoUrl << ":" << reader.errorString();
+        return QString();
+    }
+
+    foreach(int size, sizes) {
+        QString filename = thumbnailPath(key, size);
+        if (QFile::exists(filename)) {
+            continue;
+        }
+
+        QImage thumbnail = image;
+        if (image.width() > size || image.height() > size) {
+            thumbnail = image.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        }
+
+        if (!thumbnail.save(filename, "PNG")) {
+            qWarning() << "Could not save channel logo thumbnail:" << filename;
+        }
+    }
+
+    qDebug() << "Channel logo" << logoUrl << "cached with key" << key;
+    return key;
+}
+
+QString PodcastLogoCache::logoKey(const QString &logoUrl, const QByteArray &logoData)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(logoUrl.toUtf8());
+    hash.addData(QCryptographicHash::hash(logoData, QCryptographicHash::Sha1));
+    return hash.result().toHex();
+}
+
+QString PodcastLogoCache::logoKeyFromPath(const QString &logo)
+{
+    QUrl logoUrl(logo);
+    QString path = logoUrl.isLocalFile() ? logoUrl.toLocalFile() : logo;
+
+    // Logos from older versions are not in the logo cache.
+    if (!path.startsWith(logoDirectory())) {
+        return QString();
+    }
+
+    // <key>.<format> or <key>_<size>.png
+    return QFileInfo(path).completeBaseName().section('_', 0, 0);
+}
+
+QString PodcastLogoCache::logoDirectory()
+{
+    return PODCATCHER_PATH + "logos/";
+}
+
+QString PodcastLogoCache::thumbnailPath(const QString &key, int size)
+{
+    return QString("%1%2_%3.png").arg(logoDirectory()).arg(key).arg(size);
+}
+
+QString PodcastLogoCache::logoFile(const QString &key, int size)
+{
+    QString thumbnail = thumbnailPath(key, size);
+    if (size > 0 && QFile::exists(thumbnail)) {
+        return thumbnail;
+    }
+
+    QDir logoDir(logoDirectory());
+    QString originalFile;
+    QString thumbnailFile;
+    int thumbnailFileSize = 0;
+    foreach(QString filename, logoDir.entryList(QStringList() << key + "*", QDir::Files)) {
+        QString baseName = QFileInfo(filename).completeBaseName();
+        if (baseName == key) {
+            originalFile = filename;
+            continue;
+        }
+
+        int thumbnailSize = baseName.section('_', 1, 1).toInt();
+        if (size > 0 &&
+            thumbnailSize >= size &&
+            (thumbnailFileSize == 0 || thumbnailSize < thumbnailFileSize)) {
+            thumbnailFile = filename;
+            thumbnailFileSize = thumbnailSize;
+        }
+    }
+
+    if (!thumbnailFile.isEmpty()) {
+        return logoDir.filePath(thumbnailFile);
+    }
+
+    if (!originalFile.isEmpty()) {
+        return logoDir.filePath(originalFile);
+    }
+
+    return QString();
+}
+
+void PodcastLogoCache::removeLogo(const QString &key)
+{
+    if (key.isEmpty()) {
+        return;
+    }
+
+    QDir logoDir(logoDirectory());
+    foreach(QString filename, logoDir.entryList(QStringList() << key + "*", QDir::Files)) {
+        if (!logoDir.remove(filename)) {
+            qWarning() << "Could not remove cached logo:" << filename;
+        }
+    }
+}
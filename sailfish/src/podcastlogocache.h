@@ -0,0 +1,64 @@
+/**
+ * This file is part of Podcatcher for Sailfish OS.
+ * Author: Johan Paul (johan.paul@gmail.com)
+ *
+ * Podcatcher for Sailfish OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Podcatcher for Sailfish OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PODCASTLOGOCACHE_H
+#define PODCASTLOGOCACHE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+
+/**
+ * Channel logos cached on the file system.
+ *
+ * A downloaded logo is stored once in its original format, plus one PNG
+ * thumbnail for each size the UI shows it in. All files of a logo share
+ * a key computed from the logo URL and the image content:
+ *
+ *   <PODCATCHER_PATH>/logos/<key>.<original format>
+ *   <PODCATCHER_PATH>/logos/<key>_<size>.png
+ */
+class PodcastLogoCache
+{
+public:
+    /**
+     * Decodes the logo scaled to the given sizes and writes the files.
+     * Returns the key of the logo, or an empty string if the data
+     * could not be decoded. Does not touch any QObjects, so it can be
+     * run in a worker thread.
+     */
+    static QString ingestLogo(const QString &logoUrl, const QByteArray &logoData, const QList<int> &sizes);
+
+    static QString logoKey(const QString &logoUrl, const QByteArray &logoData);
+    static QString logoKeyFromPath(const QString &logo);
+
+    static QString logoDirectory();
+    static QString thumbnailPath(const QString &key, int size);
+
+    /**
+     * The cached file to show the logo from in the given size: the thumbnail
+     * of that size, the smallest larger thumbnail or the original.
+     */
+    static QString logoFile(const QString &key, int size);
+
+    static void removeLogo(const QString &key);
+
+private:
+    PodcastLogoCache();     // Don't Implement
+};
+
+#endif // PODCASTLOGOCACHE_H
@@ -23,14 +23,13 @@
 #include <QDomDocument>
 #include <QDomElement>
 #include <QDomNode>
-#include <QImage>
 #include <QFile>
 #include <QDir>
 #include <QMap>
 #include <QSettings>
+#include <QSet>
 
 #include <QtDebug>
-#include <QCryptographicHash>
 #include <QtConcurrentRun>
 #include <QFuture>
 
@@ -38,23 +37,40 @@
 #include "podcastsqlmanager.h"
 #include "podcastrssparser.h"
 #include "podcastglobals.h"
+#include "podcastlogocache.h"
+
+// Logos are not urgent. Only a couple are downloaded at a time so that they do
+// not compete with the feed requests.
+static const int MaxParallelLogoDownloads = 2;
 
 PodcastManager::PodcastManager(QObject *parent) :
     QObject(parent),
     m_channelsModel(new PodcastChannelsModel(this)),
-    m_networkManager(new QNetworkAccessManager(this)),
-    m_dlNetworkManager(new QNetworkAccessManager(this)),
+    m_network(PodcastNetworkManager::networkManager()),
+    m_gpodderReply(0),
+    m_importer(new PodcastImporter(this)),
     m_episodeModelFactory(PodcastEpisodesModelFactory::episodesFactory()),
     m_isDownloading(false),
+    m_cleanupChannelId(0),
     m_autodownloadOnSettings(false),
     m_autodownloadNumSettings(1),
     m_keepNumEpisodesSettings(0),
     m_autoDelUnplayedSettings(false)
 {
+    m_channelLogoSizes << 130;
 
     connect(this, SIGNAL(podcastChannelReady(PodcastChannel*)),
             this, SLOT(savePodcastChannel(PodcastChannel*)));
 
+    connect(m_network->accessManager(), SIGNAL(authenticationRequired(QNetworkReply *, QAuthenticator *)),
+            this, SLOT(onGPodderAuthRequired(QNetworkReply *, QAuthenticator *)));
+
+    connect(m_importer, SIGNAL(channelsImported(QList<PodcastChannel*>)),
+            this, SLOT(onChannelsImported(QList<PodcastChannel*>)));
+    connect(m_importer, SIGNAL(importFinished(int,int)),
+            this, SLOT(onImportFinished(int,int)));
+    connect(m_importer, SIGNAL(importProgress(int,int)),
+            this, SIGNAL(importProgress(int,int)));
 
 
     // Get the current settings values.
@@ -107,6 +123,12 @@ void PodcastManager::requestPodcastChannel(const QUrl &rssUrl, const QMap<QStrin
         return;
     }
 
+    QString requestKey = PodcastNetworkManager::normalisedRequestUrl(rssUrl);
+    if (channelRequestMap.contains(requestKey)) {
+        qDebug() << "Channel is already being requested. Sharing the request in flight.";
+        return;
+    }
+
     PodcastChannel *channel = new PodcastChannel(this);
     channel->setUrl(rssUrl.toString());
 
@@ -117,18 +139,8 @@ void PodcastManager::requestPodcastChannel(const QUrl &rssUrl, const QMap<QStrin
         return;
     }
 
-    channelRequestMap.insert(rssUrl.toString(), channel);
-
-    QNetworkRequest request;
-    request.setRawHeader("User-Agent", "Podcatcher Podcast client");
-    request.setUrl(rssUrl);
-
-    QNetworkReply *reply = m_networkManager->get(request);
-
-    connect(reply, SIGNAL(finished()),
-            this, SLOT(onPodcastChannelCompleted()));
-
-    m_networkManager->get(request);
+    channelRequestMap.insert(requestKey, channel);
+    fetchFeed(rssUrl);
 }
 
 void PodcastManager::refreshAllChannels()
@@ -161,8 +173,6 @@ void PodcastManager::refreshPodcastChannelEpisodes(PodcastChannel *channel, bool
         return;
     }
 
-    channel->setIsRefreshing(true);
-
     qDebug() << "Forced to get new episode data from the network.";
 
     QUrl rssUrl(channel->url());
@@ -171,37 +181,49 @@ void PodcastManager::refreshPodcastChannelEpisodes(PodcastChannel *channel, bool
         return;
     }
 
-    QNetworkRequest request;
-    request.setRawHeader("User-Agent", "Podcatcher Podcast client");
-    request.setUrl(rssUrl);
+    // The same feed may already be fetched (e.g. by refresh all). Its result is
+    // saved to this channel too, so no need to transfer it twice.
+    QString requestKey = PodcastNetworkManager::normalisedRequestUrl(rssUrl);
+    if (m_channelRefreshes.contains(requestKey, channel->channelDbId())) {
+        qDebug() << "Channel refresh already in flight. Not requesting it again.";
+        return;
+    }
 
+    channel->setIsRefreshing(true);
+    m_channelRefreshes.insert(requestKey, channel->channelDbId());
+    fetchFeed(rssUrl);
+}
 
-    QNetworkReply *reply = m_networkManager->get(request);
+/**
+ * Fetches the feed for the subscription in channelRequestMap and the
+ * refreshes in m_channelRefreshes waiting for it. A feed that is already
+ * being fetched is not fetched again, its waiters share the result.
+ */
+void PodcastManager::fetchFeed(const QUrl &url)
+{
+    QString requestKey = PodcastNetworkManager::normalisedRequestUrl(url);
+    if (m_feedRequests.contains(requestKey)) {
+        qDebug() << "Feed" << requestKey << "is already being fetched. Sharing the result.";
+        return;
+    }
 
-    insertChannelForNetworkReply(reply, channel);
+    QNetworkRequest request = m_network->request(url, PodcastNetworkManager::FeedRequest);
 
-    connect(reply, SIGNAL(finished()),
-            this, SLOT(onPodcastEpisodesRequestCompleted()));
+    bool attached = false;
+    QNetworkReply *reply = m_network->coalescedGet(request, &attached);
+    if (attached) {
+        // Someone else, e.g. the importer, reads that reply.
+        reply = m_network->get(request);
+    }
 
-    connect(reply, SIGNAL(error(QNetworkReply::NetworkError)),
-            this, SLOT(onPodcastEpisodesRequestError(QNetworkReply::NetworkError)));
+    m_feedRequests.insert(requestKey);
+    connect(reply, SIGNAL(finished()),
+            this, SLOT(onFeedRequestCompleted()));
 }
 
-
 PodcastChannel * PodcastManager::podcastChannel(int id)
 {
-    PodcastChannel *channel = NULL;
-    if (!m_channelsCache.contains(id)) {
-        channel = m_channelsModel->podcastChannelById(id);
-        if (channel == 0) {
-            return channel;
-        }
-        m_channelsCache.insert(id, channel);
-    } else {
-        channel = m_channelsCache.value(id);
-    }
-
-    return channel;
+    return m_channelsModel->podcastChannelById(id);
 }
 
 void PodcastManager::downloadPodcast(PodcastEpisode *episode)
@@ -248,43 +270,100 @@ void PodcastManager::cancelDownloadPodcast(PodcastEpisode *episode)
  * Private implementations.
  ********************************************************************************/
 
-void PodcastManager::onPodcastChannelCompleted()
+/**
+ * Answers all the subscriptions and refreshes waiting for the feed. They are
+ * removed from the waiters on every path.
+ */
+void PodcastManager::onFeedRequestCompleted()
 {
-    qDebug() << "Podcast network request completed.";
-
     QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
-    QString redirectedUrl = PodcastManager::redirectedRequest(reply);
+    if (reply == 0) {
+        qWarning() << "Network reply is 0. Aborting.";
+        return;
+    }
+    reply->deleteLater();
+
+    QString requestKey = PodcastNetworkManager::normalisedRequestUrl(reply->url());
+    m_feedRequests.remove(requestKey);
+    PodcastChannel *newChannel = channelRequestMap.take(requestKey);
+    QList<int> refreshedChannelIds = m_channelRefreshes.values(requestKey);
+    m_channelRefreshes.remove(requestKey);
+
+    qDebug() << "Podcast feed request completed:" << requestKey
+             << "Status Code:" << reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+
+    QString redirectedUrl = redirectedRequest(reply);
     if (!redirectedUrl.isEmpty()) {
-        requestPodcastChannel(QUrl(redirectedUrl));
-        reply->deleteLater();
+        // TODO: Update feed URL if permanent redirect
+        if (newChannel != 0) {
+            delete newChannel;
+            requestPodcastChannel(QUrl(redirectedUrl), m_logoCache);
+        }
+
+        if (!refreshedChannelIds.isEmpty()) {
+            QString redirectedKey = PodcastNetworkManager::normalisedRequestUrl(QUrl(redirectedUrl));
+            foreach(int channelId, refreshedChannelIds) {
+                if (!m_channelRefreshes.contains(redirectedKey, channelId)) {
+                    m_channelRefreshes.insert(redirectedKey, channelId);
+                }
+            }
+            fetchFeed(QUrl(redirectedUrl));
+        }
         return;
     }
 
-    if (reply->error() != QNetworkReply::NoError){
+    if (reply->error() != QNetworkReply::NoError) {
         emit showInfoBanner(reply->errorString());
-        reply->deleteLater();
+        delete newChannel;
+        foreach(int channelId, refreshedChannelIds) {
+            PodcastChannel *channel = podcastChannel(channelId);
+            if (channel != 0) {
+                channel->setIsRefreshing(false);
+            }
+        }
         return;
     }
 
-    QByteArray data = reply->readAll();
+    QByteArray data = m_network->readAll(reply);
+
+    if (newChannel != 0) {
+        saveNewChannel(newChannel, data);
+    }
+
+    foreach(int channelId, refreshedChannelIds) {
+        PodcastChannel *channel = podcastChannel(channelId);
+        if (channel == 0) {
+            qDebug() << "Channel" << channelId << "was removed while it was refreshed.";
+            continue;
+        }
+
+        channel->setXml(data);
+        savePodcastEpisodes(channel);
+    }
+}
+
+/**
+ * Parses the feed of a new subscription and hands the channel over to be
+ * saved, or deletes it if the feed is not valid.
+ */
+void PodcastManager::saveNewChannel(PodcastChannel *channel, const QByteArray &data)
+{
     if (data.size() < 1) {
         qDebug() << "No data in the network reply. Aborting";
         //emit showInfoBanner(tr("Unable to add subscription from that location"));
         emit showInfoBanner(tr("No data received."));
+        delete channel;
         return;
     }
 
-    PodcastChannel *channel = channelRequestMap.value(reply->url().toString());
-
-    QString readyLogoUrl = m_logoCache.value(reply->url().toString());
+    QString readyLogoUrl = m_logoCache.value(channel->url());
     if (!readyLogoUrl.isEmpty()) {
         qDebug() << "Got logo from subscription information. Setting it." << readyLogoUrl;
         channel->setLogoUrl(readyLogoUrl);
-        m_logoCache.remove(reply->url().toString());
+        m_logoCache.remove(channel->url());
     }
 
     channel->setXml(data);
-    channelRequestMap.remove(reply->url().toString());
 
 /*    if (PodcastRSSParser::isValidPodcastFeed(data) == false) {
         qDebug() << "Podcast feed is not valid! Not adding data to DB...";
@@ -298,20 +377,14 @@ void PodcastManager::onPodcastChannelCompleted()
                                                             channel->xml());
     if (rssOk == false) {
         emit showInfoBanner(tr("Podcast feed is not valid. Cannot add subscription..."));
+        delete channel;
         return;
     }
 
-    // Cache the channel logo locally on file system.
-    if (!channel->logoUrl().isEmpty()) {
-        QNetworkReply *logoReply = downloadChannelLogo(channel->logoUrl());
-        // Use a local map to map data matching this network request to the reply
-        // we get.
-        insertChannelForNetworkReply(logoReply, channel);
-    } else {
-        emit podcastChannelReady(channel);
-    }
-
-    reply->deleteLater();
+    // Save and show the channel right away. The logo is fetched in the background
+    // and shown when it arrives.
+    emit podcastChannelReady(channel);
+    queueChannelLogo(channel);
 }
 
 void PodcastManager::onPodcastChannelLogoCompleted() {
@@ -324,116 +397,69 @@ void PodcastManager::onPodcastChannelLogoCompleted() {
         return;
     }
 
+    // Several channels can share the same logo URL, and hence the same logo request.
+    QList<int> channelIds = m_channelLogoRequests.values(reply);
+    m_channelLogoRequests.remove(reply);
+    reply->deleteLater();
+
     QString redirectedUrl = redirectedRequest(reply);
     if (!redirectedUrl.isEmpty()) {
-        PodcastChannel *channel = channelForNetworkReply(reply);
-
         QNetworkReply *logoReply = downloadChannelLogo(redirectedUrl);
-        reply->deleteLater();
-
-        insertChannelForNetworkReply(logoReply, channel);
+        foreach(int channelId, channelIds) {
+            m_channelLogoRequests.insert(logoReply, channelId);
+        }
 
         return;
     }
 
-    if (reply->bytesAvailable() < 1) {
+    if (reply->error() != QNetworkReply::NoError ||
+        reply->bytesAvailable() < 1) {
         qWarning() << "Got no data from the network request when downloading the logo";
         qDebug() << reply->errorString();
+        executeNextLogoDownloads();
         return;
     }
 
-    PodcastChannel *channel = channelForNetworkReply(reply);
-    reply->deleteLater();
-    QString channelTitle = channel->title();
-
-    // Use a MD5 hash of the channel name as the logo name that is stored locally.
-    QCryptographicHash hash(QCryptographicHash::Md5);
-    hash.addData(channelTitle.toLatin1());
-    QString localFilename = hash.result().toHex();
-    qDebug() << "Hash for title " << channelTitle << "=>" << localFilename <<". Using it for cached logo image.";
+    // Decoding and scaling the artwork is heavy, so do it in a worker thread.
+    QFutureWatcher<QString> *ingestWatcher = new QFutureWatcher<QString>(this);
+    m_channelLogoIngests.insert(ingestWatcher, channelIds);
 
-    // Construct the local QImage from the network data.
-    QByteArray imageData = reply->readAll();
-    QImage channelLogo = QImage::fromData(imageData);
+    connect(ingestWatcher, SIGNAL(finished()),
+            this, SLOT(onChannelLogoIngested()));
 
-    QString filename = PODCATCHER_PATH + localFilename + ".jpg";
-    qDebug() << "Saving channel logo locally to: " << filename;
+    ingestWatcher->setFuture(QtConcurrent::run(PodcastLogoCache::ingestLogo,
+                                               reply->url().toString(),
+                                               reply->readAll(),
+                                               m_channelLogoSizes));
 
-    if (channelLogo.isNull()) {
-        qWarning() << "Image is NULL";
-    }
-
-    if (!channelLogo.save(filename)) {
-        qWarning() << "Could not save image: " << filename;
-    }
-
-    channel->setLogo(QUrl::fromLocalFile(filename).toString());
-
-    emit podcastChannelReady(channel);
+    executeNextLogoDownloads();
 }
 
-void PodcastManager::onPodcastEpisodesRequestCompleted()
+void PodcastManager::onChannelLogoIngested()
 {
-    qDebug() << "Podcast channel refresh finished";
-
-    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
-
-    PodcastChannel *channel = channelForNetworkReply(reply);
-    if (channel == 0) {
-        qWarning() << "Podcast channel from reply is NULL! Doing nothing.";
-        return;
-    }
-
-    qDebug() << "Status Code: " << reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
-
-
-    QString redirectedUrl = redirectedRequest(reply);
-    if (!redirectedUrl.isEmpty()) {
-        // TODO: Update feed URL if permanent redirect
-        reply->deleteLater();
-
-        QNetworkRequest request;
-        request.setRawHeader("User-Agent", "Podcatcher Podcast client");
-        request.setUrl(redirectedUrl);
-
-
-        QNetworkReply *reply = m_networkManager->get(request);
-
-        insertChannelForNetworkReply(reply, channel);
-
-        connect(reply, SIGNAL(finished()),
-                this, SLOT(onPodcastEpisodesRequestCompleted()));
-
-        connect(reply, SIGNAL(error(QNetworkReply::NetworkError)),
-                this, SLOT(onPodcastEpisodesRequestError(QNetworkReply::NetworkError)));
-
-
-        return;
-    }
-
+    QFutureWatcher<QString> *ingestWatcher = static_cast<QFutureWatcher<QString> *>(sender());
+    QList<int> channelIds = m_channelLogoIngests.take(ingestWatcher);
+    QString logoKey = ingestWatcher->result();
+    ingestWatcher->deleteLater();
 
-    if (reply->error() != QNetworkReply::NoError){
-        emit showInfoBanner(reply->errorString());
-        reply->deleteLater();
+    if (logoKey.isEmpty()) {
+        qWarning() << "Could not cache the channel logo.";
         return;
     }
 
+    // The largest thumbnail is good for all the places the logo is shown in.
+    QString logo = QUrl::fromLocalFile(PodcastLogoCache::thumbnailPath(logoKey, m_channelLogoSizes.last())).toString();
 
+    foreach(int channelId, channelIds) {
+        PodcastChannel *channel = m_channelsModel->podcastChannelById(channelId);
+        if (channel == 0) {
+            qDebug() << "Channel" << channelId << "was removed while its logo was downloaded.";
+            continue;
+        }
 
-    if (reply != 0) {
-        QByteArray episodeXmlData = reply->readAll();
-        channel->setXml(episodeXmlData);
-    }
-
-    reply->deleteLater();
-
-    savePodcastEpisodes(channel);
-}
-
-void PodcastManager::onPodcastEpisodesRequestError(QNetworkReply::NetworkError error)
-{
-    if (error != QNetworkReply::NoError) {
-        emit showInfoBanner(tr("Cannot refresh. Network error."));
+        // Updates the LogoRole of the channel in the channels model.
+        channel->setLogo(logo);
+        m_channelsModel->updateChannel(channel);
     }
 }
 
@@ -458,12 +484,14 @@ bool PodcastManager::savePodcastEpisodes(PodcastChannel *channel)
 
     if (!rssOk) {
          emit showInfoBanner(tr("Podcast feed invalid. Cannot download episodes for '%1'.").arg(channel->title()));
+         channel->setIsRefreshing(false);
          return false;
      }
 
 
-    PodcastEpisodesModel *episodeModel = m_episodeModelFactory->episodesModel(channel->channelDbId());  // FIXME: Pass only channel to episodes model - not the DB id.
-    episodeModel->addEpisodes(*parsedEpisodes);
+    // Saved straight to the DB. Only an episodes model that exists already is updated.
+    m_episodeModelFactory->saveNewEpisodes(channel->channelDbId(), *parsedEpisodes);  // The factory owns the episodes now.
+    delete parsedEpisodes;
 
     qDebug() << "Downloading automatically new episodes:" << m_autodownloadOnSettings << " WiFi:" << PodcastManager::isConnectedToWiFi();
 
@@ -472,7 +500,7 @@ bool PodcastManager::savePodcastEpisodes(PodcastChannel *channel)
     //  - We are connected to the WiFi
     if (PodcastManager::isConnectedToWiFi() &&
         channel->isAutoDownloadOn()) {
-        downloadNewEpisodes(episodeModel->channelId());
+        downloadNewEpisodes(channel->channelDbId());
     }
 
     channel->setIsRefreshing(false);
@@ -523,7 +551,6 @@ void PodcastManager::onPodcastEpisodeDownloaded(PodcastEpisode *episode)
 
     PodcastEpisodesModel *episodeModel = m_episodeModelFactory->episodesModel(episode->channelid());
     episodeModel->refreshEpisode(episode);
-    m_channelsModel->refreshChannel(episode->channelid());
 
     PodcastChannel *channel = m_channelsModel->podcastChannelById(episode->channelid());
     channel->setIsDownloading(false);
@@ -588,7 +615,6 @@ void PodcastManager::executeNextDownload()
 
         episode->setState(PodcastEpisode::DownloadingState);
         episode->setHasBeenCanceled(false);
-        episode->setDownloadManager(m_dlNetworkManager);
         episode->downloadEpisode();
     } else {
         if (m_episodeDownloadQueue.isEmpty()) {
@@ -613,51 +639,48 @@ QString PodcastManager::redirectedRequest(QNetworkReply *reply)
 
 QNetworkReply * PodcastManager::downloadChannelLogo(QString logoUrl)
 {
-    QNetworkRequest r;
-    r.setUrl(QUrl(logoUrl));
+    QNetworkRequest r = m_network->request(QUrl(logoUrl), PodcastNetworkManager::LogoRequest);
 
-    QNetworkReply *logoReply = m_networkManager->get(r);
+    bool attached = false;
+    QNetworkReply *logoReply = m_network->coalescedGet(r, &attached);
 
-    connect(logoReply, SIGNAL(finished()),
-            this, SLOT(onPodcastChannelLogoCompleted()));
+    if (!attached) {
+        connect(logoReply, SIGNAL(finished()),
+                this, SLOT(onPodcastChannelLogoCompleted()));
+    }
 
     return logoReply;
 }
 
-void PodcastManager::insertChannelForNetworkReply(QNetworkReply *reply, PodcastChannel *channel)
+void PodcastManager::queueChannelLogo(PodcastChannel *channel)
 {
-    if (reply == 0) {
-        qWarning() << "Network reply is NULL. Inserting nothing.";
+    if (channel->logoUrl().isEmpty() ||
+        channel->channelDbId() < 1) {
+        return;
     }
 
-    if (channel == 0) {
-        qWarning() << "Channel is NULL. Inserting nothing.";
+    if (!m_channelLogoQueue.contains(channel->channelDbId())) {
+        m_channelLogoQueue.append(channel->channelDbId());
     }
 
-    m_channelNetworkRequestCache.insert(reply, channel);
+    executeNextLogoDownloads();
 }
 
-PodcastChannel * PodcastManager::channelForNetworkReply(QNetworkReply *reply)
+void PodcastManager::executeNextLogoDownloads()
 {
-    PodcastChannel *channel = 0;
-    if (reply == 0) {
-        return channel;
-    }
-
-    if (m_channelNetworkRequestCache.isEmpty()) {
-        qWarning() << "Podcast channel network cache is empty. Returning NULL channel!";
-        return channel;
-    }
+    while (m_channelLogoRequests.uniqueKeys().size() < MaxParallelLogoDownloads &&
+           !m_channelLogoQueue.isEmpty()) {
+        int channelId = m_channelLogoQueue.takeFirst();
+
+        // The channel may have been removed while it was in the queue.
+        PodcastChannel *channel = m_channelsModel->podcastChannelById(channelId);
+        if (channel == 0 || channel->logoUrl().isEmpty()) {
+            continue;
+        }
 
-    if (!m_channelNetworkRequestCache.contains(reply)) {
-        qWarning() << "Podcast channel network cache does not contain network reply. Returning NULL nhannel!";
-        return channel;
+        QNetworkReply *logoReply = downloadChannelLogo(channel->logoUrl());
+        m_channelLogoRequests.insert(logoReply, channelId);
     }
-
-    channel = m_channelNetworkRequestCache.value(reply);
-    m_channelNetworkRequestCache.remove(reply);
-
-    return channel;
 }
 
 bool PodcastManager::isConnectedToWiFi()
@@ -682,11 +705,11 @@ void PodcastManager::removePodcastChannel(int channelId)
      */
     // Fetch model from model factory - then delete it from the factory's cache.
     PodcastEpisodesModel *episodesModel = m_episodeModelFactory->episodesModel(channelId);
-    QList<PodcastEpisode *> episodes = episodesModel->episodes();
 
     // Se if any episodes are being downloaded from this channel. Remove them from queue.
-    foreach(PodcastEpisode* episode, episodes) {
-        if (m_episodeDownloadQueue.contains(episode)) {
+    QList<PodcastEpisode *> queue = m_episodeDownloadQueue;
+    foreach(PodcastEpisode* episode, queue) {
+        if (episode->channelid() == channelId) {
             onPodcastEpisodeDownloadFailed(episode);
             m_episodeDownloadQueue.removeOne(episode);  // removeOne: There ought to be always just one. Faster.
         }
@@ -702,8 +725,23 @@ void PodcastManager::removePodcastChannel(int channelId)
      * Do not touch the episode anymore!
      */
     // Deleting locally cached channel logo.
-    PodcastChannel *channel = m_channelsCache.value(channelId);
-    if (channel != NULL) {
+    PodcastChannel *channel = m_channelsModel->podcastChannelById(channelId);
+    QString logoKey = (channel != NULL) ? PodcastLogoCache::logoKeyFromPath(channel->logo()) : QString();
+    if (!logoKey.isEmpty()) {
+        // Channels with the same artwork share the cached files.
+        bool logoShared = false;
+        foreach(PodcastChannel *otherChannel, m_channelsModel->channels()) {
+            if (otherChannel != channel &&
+                PodcastLogoCache::logoKeyFromPath(otherChannel->logo()) == logoKey) {
+                logoShared = true;
+                break;
+            }
+        }
+
+        if (!logoShared) {
+            PodcastLogoCache::removeLogo(logoKey);
+        }
+    } else if (channel != NULL) {
         QUrl channelLogoUrl(channel->logo());
         QFile channelLogo(channelLogoUrl.toLocalFile());
         if (!channelLogo.remove()) {
@@ -712,9 +750,9 @@ void PodcastManager::removePodcastChannel(int channelId)
         }
     }
 
-    // Finally remove the channel from the model and the cache.
+    // Finally remove the channel from the model.
     m_channelsModel->removeChannel(channel);
-    m_channelsCache.remove(channelId);
+    m_channelLogoQueue.removeAll(channelId);
 
     // Finally delete the memory reserved for the channel
     delete channel;
@@ -723,14 +761,7 @@ void PodcastManager::removePodcastChannel(int channelId)
 void PodcastManager::deleteAllDownloadedPodcasts(int channelId)
 {
     PodcastEpisodesModel *episodesModel = m_episodeModelFactory->episodesModel(channelId);
-    QList<PodcastEpisode *> episodes = episodesModel->episodes();
-
-    foreach(PodcastEpisode *episode, episodes) {
-        if (!episode->playFilename().isEmpty()) {
-            episode->deleteDownload();
-            episodesModel->refreshEpisode(episode);
-        }
-    }
+    episodesModel->deleteAllDownloads();
 }
 
 bool PodcastManager::isDownloading()
@@ -738,6 +769,24 @@ bool PodcastManager::isDownloading()
     return m_isDownloading;
 }
 
+void PodcastManager::setChannelLogoSizes(const QList<int> &sizes)
+{
+    QList<int> logoSizes;
+    foreach(int size, sizes) {
+        if (size > 0 && !logoSizes.contains(size)) {
+            logoSizes << size;
+        }
+    }
+
+    if (logoSizes.isEmpty()) {
+        return;
+    }
+
+    qSort(logoSizes);
+    qDebug() << "Caching channel logos in sizes:" << logoSizes;
+    m_channelLogoSizes = logoSizes;
+}
+
 void PodcastManager::onAutodownloadOnChanged()
 {
     qDebug() << "Setting changed: autodl: " << QVariant(m_autoDlConf->value()).toBool();
@@ -779,40 +828,100 @@ void PodcastManager::cleanupEpisodes()
         return;
     }
 
-    m_cleanupChannels = m_channelsModel->channels();
-    if (m_cleanupChannels.isEmpty()) {
+    if (m_cleanupChannelId != 0) {
+        // A cleanup is already going on.
         return;
     }
 
-    PodcastEpisodesModel *episodesModel = m_episodeModelFactory->episodesModel((m_cleanupChannels.takeLast())->channelDbId());
-
-    QFuture<void> future = QtConcurrent::run(episodesModel,
-                                             &PodcastEpisodesModel::cleanOldEpisodes,
-                                             m_keepNumEpisodesSettings,
-                                             m_autoDelUnplayedSettings);
+    // Only the ids are kept, a channel may be deleted during the cleanup.
+    m_cleanupChannels.clear();
+    foreach(PodcastChannel *channel, m_channelsModel->channels()) {
+        m_cleanupChannels << channel->channelDbId();
+    }
+    if (m_cleanupChannels.isEmpty()) {
+        return;
+    }
 
-    m_futureWatcher.setFuture(future);
     connect(&m_futureWatcher, SIGNAL(finished()),
-            this, SLOT(onCleanupEpisodeModelFinished()));
+            this, SLOT(onCleanupEpisodeModelFinished()), Qt::UniqueConnection);
+    cleanupNextChannel();
 }
 
 void PodcastManager::onCleanupEpisodeModelFinished()
 {
+    QList<PodcastEpisodeData> episodes = m_futureWatcher.result();
+
+    // Only a model that is already loaded has rows to remove. A download
+    // may have been started while the old episodes were looked for.
+    PodcastEpisodesModel *episodesModel = m_episodeModelFactory->cachedModel(m_cleanupChannelId);
+    if (episodesModel != 0) {
+        QList<int> activeIds = episodesModel->activeEpisodeIds();
+        for (int i=episodes.size()-1; i>=0; i--) {
+            if (activeIds.contains(episodes.at(i).dbid)) {
+                episodes.removeAt(i);
+            }
+        }
+    }
+
+    if (PodcastSQLManagerFactory::sqlmanager()->removePodcastsFromDB(episodes) && episodesModel != 0) {
+        QList<int> dbids;
+        foreach(const PodcastEpisodeData &episode, episodes) {
+            dbids << episode.dbid;
+        }
+        episodesModel->removeEpisodeRows(dbids);
+    }
+
+    m_cleanupChannelId = 0;
+
     if (m_cleanupChannels.isEmpty()) {
         // All channels cleaned up.
         return;
     }
 
-    PodcastEpisodesModel *episodesModel = m_episodeModelFactory->episodesModel((m_cleanupChannels.takeLast())->channelDbId());
+    cleanupNextChannel();
+}
 
-    QFuture<void> future = QtConcurrent::run(episodesModel,
-                                             &PodcastEpisodesModel::cleanOldEpisodes,
-                                             m_keepNumEpisodesSettings,
-                                             m_autoDelUnplayedSettings);
+void PodcastManager::cleanupNextChannel()
+{
+    m_cleanupChannelId = m_cleanupChannels.takeLast();
+
+    QList<int> activeIds;
+    PodcastEpisodesModel *episodesModel = m_episodeModelFactory->cachedModel(m_cleanupChannelId);
+    if (episodesModel != 0) {
+        activeIds = episodesModel->activeEpisodeIds();
+    }
+
+    QFuture<QList<PodcastEpisodeData> > future = QtConcurrent::run(&PodcastManager::cleanOldEpisodes,
+                                                                    m_cleanupChannelId,
+                                                                    m_keepNumEpisodesSettings,
+                                                                    m_autoDelUnplayedSettings,
+                                                                    activeIds);
 
     m_futureWatcher.setFuture(future);
 }
 
+/**
+ * Looks for the old episodes of the channel in the DB and deletes their
+ * downloads. Run in a worker thread; the episodes are removed from the DB
+ * and from the model in onCleanupEpisodeModelFinished().
+ */
+QList<PodcastEpisodeData> PodcastManager::cleanOldEpisodes(int channelId, int keepNumEpisodes, bool keepUnplayed, QList<int> activeIds)
+{
+    QList<PodcastEpisodeData> episodes = PodcastSQLManagerFactory::sqlmanager()->oldEpisodesInDB(channelId, keepNumEpisodes, keepUnplayed);
+
+    for (int i=episodes.size()-1; i>=0; i--) {
+        // The episodes being downloaded or streamed are kept.
+        if (activeIds.contains(episodes.at(i).dbid)) {
+            episodes.removeAt(i);
+            continue;
+        }
+
+        episodes[i].deleteDownload();
+    }
+
+    return episodes;
+}
+
 void PodcastManager::updateAutoDLSettingsFromCache()
 {
     QSettings settings("harbour-podcatcher", "Podcatcher");
@@ -843,23 +952,22 @@ void PodcastManager::fetchSubscriptionsFromGPodder(QString gpodderUsername, QStr
     m_gpodderUsername = gpodderUsername;
     m_gpodderPassword = gpodderPassword;
 
-    m_gpodderQNAM = new QNetworkAccessManager();
-
-    connect(m_gpodderQNAM, SIGNAL(authenticationRequired(QNetworkReply *, QAuthenticator *)),
-            this, SLOT(onGPodderAuthRequired(QNetworkReply *, QAuthenticator *)));
-
     QString gpodderUrl = QString("http://gpodder.net/subscriptions/%1.xml").arg(m_gpodderUsername);
 
     qDebug() << "Sending request to gPodder.net: " << gpodderUrl;
 
-    QNetworkReply *reply = m_gpodderQNAM->get(QNetworkRequest(QUrl(gpodderUrl)));
-    connect(reply, SIGNAL(finished()),
+    m_gpodderReply = m_network->get(m_network->request(QUrl(gpodderUrl), PodcastNetworkManager::DirectoryRequest));
+    connect(m_gpodderReply, SIGNAL(finished()),
             this, SLOT(onGPodderRequestFinished()));
 }
 
 void PodcastManager::onGPodderAuthRequired(QNetworkReply *reply, QAuthenticator *auth)
 {
-    Q_UNUSED(reply);
+    // The network manager is shared by the whole application, so only answer
+    // the challenge of our own gPodder.net request.
+    if (reply != m_gpodderReply) {
+        return;
+    }
 
     if (m_gpodderUsername.isEmpty() ||
         m_gpodderPassword.isEmpty()) {
@@ -870,13 +978,10 @@ void PodcastManager::onGPodderAuthRequired(QNetworkReply *reply, QAuthenticator
         emit showInfoBanner(tr("gPodder.net credentials not accepted. Try again."));
 
         // Clean up the resources. This ends here...
-        QNetworkAccessManager *qnam = reply->manager();
         disconnect(reply, SIGNAL(finished()), this,
                           SLOT(onGPodderRequestFinished()));
-        disconnect(qnam, SIGNAL(authenticationRequired(QNetworkReply*,QAuthenticator*)), this,
-                               SLOT(onGPodderAuthRequired(QNetworkReply *, QAuthenticator *)));
 
-        qnam->deleteLater();
+        m_gpodderReply = 0;
         reply->close();
         reply->deleteLater();
 
@@ -895,18 +1000,15 @@ void PodcastManager::onGPodderAuthRequired(QNetworkReply *reply, QAuthenticator
 void PodcastManager::onGPodderRequestFinished()
 {
     QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
-    QNetworkAccessManager *gpodderQNAM = reply->manager();
 
     disconnect(reply, SIGNAL(finished()), this,
                       SLOT(onGPodderRequestFinished()));
-    disconnect(gpodderQNAM, SIGNAL(authenticationRequired(QNetworkReply*,QAuthenticator*)), this,
-                           SLOT(onGPodderAuthRequired(QNetworkReply *, QAuthenticator *)));
-    QByteArray xml = reply->readAll();
+    QByteArray xml = m_network->readAll(reply);
 
     qDebug() << "Response from gpodder: " << xml;
 
+    m_gpodderReply = 0;
     reply->deleteLater();
-    gpodderQNAM->deleteLater();
 
     QList<QString> subscriptionUrls = PodcastRSSParser::parseGPodderSubscription(xml);
     if (subscriptionUrls.size() < 1) {
@@ -916,47 +1018,70 @@ void PodcastManager::onGPodderRequestFinished()
 
     emit showInfoBanner(tr("Getting subscriptions from gPodder.net..."));
 
-    foreach(QString url, subscriptionUrls) {
-        requestPodcastChannelFromGPodder(QUrl(url));
-    }
-
+    importSubscriptions(subscriptionUrls);
 }
 
-void PodcastManager::requestPodcastChannelFromGPodder(const QUrl &rssUrl)
+void PodcastManager::importSubscriptionsFromOPML(const QString &opmlFile)
 {
-    qDebug() << "Requesting Podcast channel" << rssUrl;
+    qDebug() << "Importing subscriptions from OPML file" << opmlFile;
 
-    if (!rssUrl.isValid()) {
-        qWarning() << "Provided podcast channel URL is not valid.";
+    QFile file(opmlFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not open OPML file:" << file.errorString();
+        emit showInfoBanner(tr("Could not open the OPML file."));
         return;
     }
 
-    PodcastChannel *channel = new PodcastChannel(this);
-    channel->setUrl(rssUrl.toString());
-
-    if (m_channelsModel->channelAlreadyExists(channel)) {
-        qDebug() << "Channel is already in DB. Not doing anything.";
-        delete channel;
+    QList<QString> subscriptionUrls = PodcastRSSParser::parseOPMLSubscription(file.readAll());
+    if (subscriptionUrls.size() < 1) {
+        emit showInfoBanner(tr("No subscriptions found from the OPML file"));
         return;
     }
 
-    if (channelRequestMap.contains(rssUrl.toString())) {
-        qDebug() << "Duplicate URL from gPodder.net. Not requesting the same podcast again.";
-        return;
+    emit showInfoBanner(tr("Importing subscriptions..."));
+
+    importSubscriptions(subscriptionUrls);
+}
+
+void PodcastManager::importSubscriptions(const QList<QString> &urls)
+{
+    QSet<QString> subscribedUrls;
+    foreach(PodcastChannel *channel, m_channelsModel->channels()) {
+        subscribedUrls.insert(PodcastNetworkManager::normalisedRequestUrl(QUrl(channel->url())));
     }
 
-    channelRequestMap.insert(rssUrl.toString(), channel);
+    m_importer->importSubscriptions(urls, subscribedUrls, m_autodownloadOnSettings);
+}
 
-    QNetworkRequest request;
-    request.setUrl(rssUrl);
+void PodcastManager::onChannelsImported(QList<PodcastChannel *> channels)
+{
+    qDebug() << "Got" << channels.size() << "imported channels.";
 
-    QNetworkReply *reply = m_networkManager->get(request);
+    foreach(PodcastChannel *channel, channels) {
+        channel->setParent(this);
+    }
 
-    connect(reply, SIGNAL(finished()),
-            this, SLOT(onPodcastChannelCompleted()));
+    m_channelsModel->addImportedChannels(channels);
 
-    m_networkManager->get(request);
+    foreach(PodcastChannel *channel, channels) {
+        queueChannelLogo(channel);
+
+        if (PodcastManager::isConnectedToWiFi() &&
+            channel->isAutoDownloadOn()) {
+            downloadNewEpisodes(channel->channelDbId());
+        }
+    }
+
+    emit podcastChannelSaved();
 }
 
+void PodcastManager::onImportFinished(int imported, int failed)
+{
+    if (failed > 0) {
+        emit showInfoBanner(tr("Imported %1 subscriptions. %2 could not be imported.").arg(imported).arg(failed));
+    } else {
+        emit showInfoBanner(tr("Imported %1 subscriptions.").arg(imported));
+    }
+}
 
 
@@ -23,6 +23,7 @@
 #include <QNetworkAccessManager>
 #include <QUrl>
 #include <QMap>
+#include <QSet>
 #include <QVariant>
 #include <QFutureWatcher>
 #include <QFutureSynchronizer>
@@ -37,6 +38,8 @@
 #include "podcastchannelsmodel.h"
 #include "podcastepisodesmodel.h"
 #include "podcastepisodesmodelfactory.h"
+#include "podcastnetworkmanager.h"
+#include "podcastimporter.h"
 
 class PodcastSQLManager;
 class QAuthenticator;
@@ -60,7 +63,7 @@ public:
     void requestPodcastChannel(const QUrl &rssUrl, const QMap<QString, QString> &logoCache = QMap<QString, QString>());
 
     void fetchSubscriptionsFromGPodder(QString username, QString password);
-    void requestPodcastChannelFromGPodder(const QUrl &rssUrl);
+    void importSubscriptionsFromOPML(const QString &opmlFile);
 
     void refreshPodcastChannelEpisodes(PodcastChannel *channel, bool forceNetworkUpdate = false);
     void refreshAllChannels();
@@ -75,6 +78,12 @@ public:
     void deleteAllDownloadedPodcasts(int channelId);
     bool isDownloading();
 
+    /**
+     * The sizes in pixels the UI shows channel logos in. A thumbnail
+     * of each size is cached when a logo is downloaded.
+     */
+    void setChannelLogoSizes(const QList<int> &sizes);
+
     static QString redirectedRequest(QNetworkReply *reply);
 
     static bool isConnectedToWiFi();
@@ -91,17 +100,16 @@ signals:
     void podcastEpisodeDownloaded(PodcastEpisode *episode);
     void showInfoBanner(QString text);
     void downloadingPodcasts(bool downloading);
+    void importProgress(int done, int total);
 
 public slots:
     void cleanupEpisodes();     // This is a slot, since it is called from Podcatcher UI constructor with single shot timer.
 
 private slots:
    void savePodcastChannel(PodcastChannel *channel);
-   void onPodcastChannelCompleted();
+   void onFeedRequestCompleted();
    void onPodcastChannelLogoCompleted();
-
-   void onPodcastEpisodesRequestCompleted();
-   void onPodcastEpisodesRequestError(QNetworkReply::NetworkError error);
+   void onChannelLogoIngested();
 
    void onPodcastEpisodeDownloaded(PodcastEpisode *episode);
    void onPodcastEpisodeDownloadFailed(PodcastEpisode* episode);
@@ -116,26 +124,37 @@ private slots:
    void onGPodderRequestFinished();
    void onGPodderAuthRequired(QNetworkReply *reply, QAuthenticator *auth);
 
+   void onChannelsImported(QList<PodcastChannel *> channels);
+   void onImportFinished(int imported, int failed);
+
 private:
    void executeNextDownload();
+   void cleanupNextChannel();
+   static QList<PodcastEpisodeData> cleanOldEpisodes(int channelId, int keepNumEpisodes, bool keepUnplayed, QList<int> activeIds);
    QNetworkReply * downloadChannelLogo(QString logoUrl);
-   void insertChannelForNetworkReply(QNetworkReply *reply, PodcastChannel *channel);
-   PodcastChannel * channelForNetworkReply(QNetworkReply *reply);
+   void queueChannelLogo(PodcastChannel *channel);
+   void executeNextLogoDownloads();
+   void fetchFeed(const QUrl &url);
+   void saveNewChannel(PodcastChannel *channel, const QByteArray &data);
    bool savePodcastEpisodes(PodcastChannel *channel);
    void updateAutoDLSettingsFromCache();
+   void importSubscriptions(const QList<QString> &urls);
 
    PodcastChannelsModel *m_channelsModel;
 
-   // We need multiple QNAMs to be able to do concurrent downloads.
-   QNetworkAccessManager *m_networkManager;
-   QNetworkAccessManager *m_dlNetworkManager;  // Share this between all the episodes;
-   QNetworkAccessManager *m_gpodderQNAM;
+   PodcastNetworkManager *m_network;
+   QNetworkReply *m_gpodderReply;
+   PodcastImporter *m_importer;
 
-   QMap<QNetworkReply*, PodcastChannel *> m_channelNetworkRequestCache;
-   QMap<int, PodcastChannel *> m_channelsCache;
+   QMultiMap<QNetworkReply*, int> m_channelLogoRequests;    // Logo reply -> ids of the channels waiting for it.
+   QList<int> m_channelLogoQueue;
+   QMap<QFutureWatcher<QString> *, QList<int> > m_channelLogoIngests;    // Logos being decoded -> ids of the channels waiting for them.
+   QList<int> m_channelLogoSizes;
 
    PodcastEpisodesModelFactory *m_episodeModelFactory;
-   QMap<QString, PodcastChannel *> channelRequestMap;
+   QMap<QString, PodcastChannel *> channelRequestMap;         // Feed URL -> the new channel waiting for it.
+   QMultiMap<QString, int> m_channelRefreshes;                // Feed URL -> ids of the channels waiting for it.
+   QSet<QString> m_feedRequests;                              // Feed URLs being fetched.
 
    QList<PodcastEpisode *> m_episodeDownloadQueue;
    bool m_isDownloading;
@@ -147,8 +166,9 @@ private:
    MGConfItem *m_autoDelUnplayedConf;
 
 
-    QList<PodcastChannel *> m_cleanupChannels;
-    QFutureWatcher<void> m_futureWatcher;
+    QList<int> m_cleanupChannels;
+    int m_cleanupChannelId;
+    QFutureWatcher<QList<PodcastEpisodeData> > m_futureWatcher;
 
 
    bool m_autodownloadOnSettings;
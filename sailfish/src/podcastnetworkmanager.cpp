@@ -0,0 +1,202 @@
+/**
+ * This file is part of Podcatcher for Sailfish OS.
+ * Author: Johan Paul (johan.paul@gmail.com)
+ *
+ * Podcatcher for Sailfish OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Podcatcher for Sailfish OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <QtDebug>
+
+#include "podcastnetworkmanager.h"
+
+PodcastNetworkManager * PodcastNetworkManager::instance = 0;
+
+PodcastNetworkManager::PodcastNetworkManager(QObject *parent) :
+    QObject(parent),
+    m_qnam(new QNetworkAccessManager(this))
+{
+}
+
+PodcastNetworkManager * PodcastNetworkManager::networkManager()
+{
+    if (instance == 0) {
+        instance = new PodcastNetworkManager;
+    }
+    return instance;
+}
+
+QNetworkAccessManager * PodcastNetworkManager::accessManager() const
+{
+    return m_qnam;
+}
+
+QNetworkRequest PodcastNetworkManager::request(const QUrl &url, RequestPurpose purpose) const
+{
+    QNetworkRequest request(url);
+    request.setRawHeader("User-Agent", "Podcatcher Podcast client");
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+    request.setAttribute(QNetworkRequest::HTTP2AllowedAttribute, true);
+#endif
+
+    // Feeds and gPodder.net XML compress 5-10x. Ask for it explicitly, so that the
+    // feeds stay compressed whatever other headers get added to the request.
+    if (purpose == FeedRequest || purpose == DirectoryRequest) {
+        request.setRawHeader("Accept-Encoding", PodcastContentDecoder::acceptEncoding());
+    }
+
+    // Requests with a higher priority are sent first when the connections
+    // to a host are all busy.
+    switch(purpose) {
+    case StreamResolverRequest:
+    case DirectoryRequest:
+        request.setPriority(QNetworkRequest::HighPriority);
+        break;
+    case LogoRequest:
+    case EpisodeDownloadRequest:
+        request.setPriority(QNetworkRequest::LowPriority);
+        break;
+    case FeedRequest:
+    default:
+        request.setPriority(QNetworkRequest::NormalPriority);
+        break;
+    }
+
+    return request;
+}
+
+QNetworkReply * PodcastNetworkManager::get(const QNetworkRequest &request)
+{
+    return startGet(request);
+}
+
+QNetworkReply * PodcastNetworkManager::coalescedGet(const QNetworkRequest &request, bool *attached)
+{
+    QString requestKey = normalisedRequestUrl(request.url());
+
+    QNetworkReply *reply = m_inFlightRequests.value(requestKey);
+    if (reply != 0) {
+        qDebug() << "Request to" << requestKey << "already in flight. Sharing the reply.";
+        if (attached != 0) {
+            *attached = true;
+        }
+        return reply;
+    }
+
+    reply = startGet(request);
+    m_inFlightRequests.insert(requestKey, reply);
+
+    // Connected before any of the callers, so that the request is unregistered
+    // by the time the result is handled.
+    connect(reply, SIGNAL(finished()),
+            this, SLOT(onInFlightRequestFinished()));
+
+    if (attached != 0) {
+        *attached = false;
+    }
+    return reply;
+}
+
+void PodcastNetworkManager::onInFlightRequestFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (reply == 0) {
+        return;
+    }
+
+    QString requestKey = m_inFlightRequests.key(reply);
+    if (!requestKey.isEmpty()) {
+        m_inFlightRequests.remove(requestKey);
+    }
+}
+
+QNetworkReply * PodcastNetworkManager::startGet(const QNetworkRequest &request)
+{
+    QNetworkReply *reply = m_qnam->get(request);
+
+    // If we set Accept-Encoding ourselves, QNetworkAccessManager leaves the body as it is.
+    if (request.hasRawHeader("Accept-Encoding")) {
+        m_encodedReplies.insert(reply, EncodedReply());
+
+        connect(reply, SIGNAL(readyRead()),
+                this, SLOT(onEncodedReplyReadyRead()));
+        connect(reply, SIGNAL(destroyed(QObject*)),
+                this, SLOT(onEncodedReplyDestroyed(QObject*)));
+    }
+
+    return reply;
+}
+
+void PodcastNetworkManager::onEncodedReplyReadyRead()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (reply == 0 || !m_encodedReplies.contains(reply)) {
+        return;
+    }
+
+    decodeAvailable(reply, m_encodedReplies[reply]);
+}
+
+void PodcastNetworkManager::decodeAvailable(QNetworkReply *reply, EncodedReply &encodedReply)
+{
+    if (encodedReply.decoder == 0) {
+        // The headers are known by the time the first bytes of the body arrive.
+        QByteArray contentEncoding = reply->rawHeader("Content-Encoding");
+        encodedReply.decoder = new PodcastContentDecoder(contentEncoding);
+        qDebug() << "Decoding" << reply->url() << "with content encoding" << contentEncoding;
+    }
+
+    // Decode as the data arrives, so that the compressed body is never buffered as a whole.
+    encodedReply.decoder->decode(reply->readAll(), &encodedReply.body);
+}
+
+QByteArray PodcastNetworkManager::readAll(QNetworkReply *reply)
+{
+    if (!m_encodedReplies.contains(reply)) {
+        return reply->readAll();
+    }
+
+    EncodedReply encodedReply = m_encodedReplies.take(reply);
+    disconnect(reply, SIGNAL(readyRead()),
+               this, SLOT(onEncodedReplyReadyRead()));
+
+    if (reply->bytesAvailable() > 0 || encodedReply.decoder == 0) {
+        decodeAvailable(reply, encodedReply);
+    }
+
+    bool decodedOk = encodedReply.decoder->finish();
+    delete encodedReply.decoder;
+
+    if (!decodedOk) {
+        qWarning() << "Could not decode the response from" << reply->url();
+        return QByteArray();
+    }
+
+    return encodedReply.body;
+}
+
+void PodcastNetworkManager::onEncodedReplyDestroyed(QObject *reply)
+{
+    // The reply is already being destroyed, so only use the pointer as a key.
+    QNetworkReply *destroyedReply = static_cast<QNetworkReply *>(reply);
+    if (m_encodedReplies.contains(destroyedReply)) {
+        delete m_encodedReplies.take(destroyedReply).decoder;
+    }
+}
+
+QString PodcastNetworkManager::normalisedRequestUrl(const QUrl &url)
+{
+    // Fragments never reach the server and "a/./b" is the same resource as "a/b".
+    // QUrl already lower cases the scheme and the host.
+    return url.adjusted(QUrl::NormalizePathSegments | QUrl::RemoveFragment).toString(QUrl::FullyEncoded);
+}
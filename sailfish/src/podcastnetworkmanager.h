@@ -0,0 +1,102 @@
+/**
+ * This file is part of Podcatcher for Sailfish OS.
+ * Author: Johan Paul (johan.paul@gmail.com)
+ *
+ * Podcatcher for Sailfish OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Podcatcher for Sailfish OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PODCASTNETWORKMANAGER_H
+#define PODCASTNETWORKMANAGER_H
+
+#include <QObject>
+#include <QMap>
+#include <QHash>
+#include <QUrl>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+
+#include "podcastcontentdecoder.h"
+
+/**
+ * The one QNetworkAccessManager of the application. Feeds, logos, gPodder.net
+ * queries, stream resolving and episode downloads all go through it so that
+ * they share the same connection pool, HTTP/2 sessions and TLS sessions to
+ * the (usually few) hosts the podcasts are on.
+ *
+ * Each request is tagged with a purpose which decides its priority in the
+ * connection queue, so that a logo or an episode download never holds back
+ * something the user is waiting for.
+ */
+class PodcastNetworkManager : public QObject
+{
+    Q_OBJECT
+public:
+    enum RequestPurpose {
+        FeedRequest = 0,
+        DirectoryRequest,
+        LogoRequest,
+        StreamResolverRequest,
+        EpisodeDownloadRequest
+    };
+
+    static PodcastNetworkManager* networkManager();
+
+    QNetworkAccessManager * accessManager() const;
+
+    QNetworkRequest request(const QUrl &url, RequestPurpose purpose) const;
+    QNetworkReply * get(const QNetworkRequest &request);
+
+    /**
+     * Like get(), but if a request to the same (normalised) URL is already
+     * in flight, that reply is returned instead of starting a new transfer and
+     * attached is set to true. In that case the caller must not connect its
+     * slots to the reply again.
+     */
+    QNetworkReply * coalescedGet(const QNetworkRequest &request, bool *attached = 0);
+
+    /**
+     * Returns the body of a finished reply. Feed and directory requests ask for
+     * compressed transfer explicitly, so Qt does not decode them for us. Their
+     * body is decoded here while it arrives and the decoded bytes are returned.
+     */
+    QByteArray readAll(QNetworkReply *reply);
+
+    static QString normalisedRequestUrl(const QUrl &url);
+
+signals:
+
+private slots:
+    void onInFlightRequestFinished();
+    void onEncodedReplyReadyRead();
+    void onEncodedReplyDestroyed(QObject *reply);
+
+private:
+    struct EncodedReply {
+        EncodedReply() : decoder(0) {}
+        PodcastContentDecoder *decoder;
+        QByteArray body;
+    };
+
+    PodcastNetworkManager(QObject *parent = 0);
+    QNetworkReply * startGet(const QNetworkRequest &request);
+    void decodeAvailable(QNetworkReply *reply, EncodedReply &encodedReply);
+
+    static PodcastNetworkManager *instance;
+
+    QNetworkAccessManager *m_qnam;
+    QMap<QString, QNetworkReply *> m_inFlightRequests;    // Normalised URL -> reply, so that concurrent requests share one transfer.
+    QHash<QNetworkReply *, EncodedReply> m_encodedReplies;
+};
+
+#endif // PODCASTNETWORKMANAGER_H
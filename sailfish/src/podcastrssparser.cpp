@@ -358,3 +358,28 @@ QList<QString> PodcastRSSParser::parseGPodderSubscription(QByteArray gpodderXml)
     return subscriptions;
 }
 
+QList<QString> PodcastRSSParser::parseOPMLSubscription(QByteArray opmlXml) {
+    QDomDocument xmlDocument;
+    if (xmlDocument.setContent(opmlXml) == false) {
+        qDebug() << "Could not parse the OPML file to get subscriptions.";
+        return QList<QString>();
+    }
+
+    QList<QString> subscriptions;
+    QDomElement docElement = xmlDocument.documentElement();
+    QDomNodeList outlineNodes = docElement.elementsByTagName("outline");  // Get all the "outline" nodes, also the ones inside categories.
+    for (uint i=0; i<outlineNodes.length(); i++) {
+        QDomElement outline = outlineNodes.at(i).toElement();
+
+        // Category outlines do not have a feed URL.
+        QString subscriptionUrl = outline.attribute("xmlUrl").trimmed();
+        if (subscriptionUrl.isEmpty()) {
+            continue;
+        }
+
+        qDebug() << "Found new subscription from OPML: " << subscriptionUrl;
+        subscriptions.append(subscriptionUrl);
+    }
+
+    return subscriptions;
+}
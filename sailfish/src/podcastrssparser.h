@@ -41,6 +41,7 @@ public:
     static bool isValidPodcastFeed(QByteArray xmlReply);
 
     static QList<QString> parseGPodderSubscription(QByteArray gpodderXml);
+    static QList<QString> parseOPMLSubscription(QByteArray opmlXml);
 
 signals:
 
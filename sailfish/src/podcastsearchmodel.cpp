@@ -0,0 +1,98 @@
+/**
+ * This file is part of Podcatcher for Sailfish OS.
+ * Author: Johan Paul (johan.paul@gmail.com)
+ *
+ * Podcatcher for Sailfish OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Podcatcher for Sailfish OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <QtDebug>
+
+#include "podcastsearchmodel.h"
+
+// The number of episodes shown for a search.
+static const int SearchResultLimit = 100;
+
+PodcastSearchModel::PodcastSearchModel(QObject *parent) :
+    QAbstractListModel(parent)
+{
+    m_roles[DbidRole] = "dbid";
+    m_roles[ChannelIdRole] = "channelId";
+    m_roles[TitleRole] = "title";
+    m_roles[ChannelTitleRole] = "channelTitle";
+    m_roles[PubRole] = "published";
+    m_roles[PreviewRole] = "descriptionPreview";
+
+    m_sqlmanager = PodcastSQLManagerFactory::sqlmanager();
+}
+
+int PodcastSearchModel::rowCount(const QModelIndex &) const
+{
+    return m_results.size();
+}
+
+QVariant PodcastSearchModel::data(const QModelIndex &index, int role) const
+{
+    if (index.row() < 0 || index.row() >= m_results.count())
+        return QVariant();
+
+    const PodcastEpisodeSummary &result = m_results.at(index.row());
+
+    switch(role) {
+    case DbidRole:
+        return result.episodeId;
+        break;
+    case ChannelIdRole:
+        return result.channelId;
+        break;
+    case TitleRole:
+        return result.title;
+        break;
+    case ChannelTitleRole:
+        return result.channelTitle;
+        break;
+    case PubRole:
+        return result.published.toString(tr("dd.MM.yyyy"));
+        break;
+    case PreviewRole:
+        return result.preview;
+        break;
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> PodcastSearchModel::roleNames() const
+{
+    return m_roles;
+}
+
+void PodcastSearchModel::search(const QString &text)
+{
+    QString searchText = text.trimmed();
+    if (searchText == m_searchText) {
+        return;
+    }
+
+    beginResetModel();
+    m_searchText = searchText;
+    m_results = m_sqlmanager->searchEpisodesInDB(searchText, SearchResultLimit);
+    endResetModel();
+
+    qDebug() << "Search" << searchText << "found" << m_results.size() << "episodes";
+    emit searchTextChanged();
+}
+
+QString PodcastSearchModel::searchText() const
+{
+    return m_searchText;
+}
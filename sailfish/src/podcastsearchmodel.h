@@ -0,0 +1,65 @@
+/**
+ * This file is part of Podcatcher for Sailfish OS.
+ * Author: Johan Paul (johan.paul@gmail.com)
+ *
+ * Podcatcher for Sailfish OS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Podcatcher for Sailfish OS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PODCASTSEARCHMODEL_H
+#define PODCASTSEARCHMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+
+#include "podcastsqlmanager.h"
+
+/**
+ * The episodes of the subscribed channels that match a search text, best
+ * matches first. See PodcastSQLManager::searchEpisodesInDB().
+ */
+class PodcastSearchModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QString searchText READ searchText NOTIFY searchTextChanged)
+
+public:
+    enum SearchRoles {
+        DbidRole = Qt::UserRole + 1,
+        ChannelIdRole,
+        TitleRole,
+        ChannelTitleRole,
+        PubRole,
+        PreviewRole
+    };
+
+    explicit PodcastSearchModel(QObject *parent = 0);
+
+    int rowCount(const QModelIndex & parent = QModelIndex()) const;
+    QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
+    QHash<int, QByteArray> roleNames() const;
+
+    Q_INVOKABLE void search(const QString &text);
+    QString searchText() const;
+
+signals:
+    void searchTextChanged();
+
+private:
+    QList<PodcastEpisodeSummary> m_results;
+    QString m_searchText;
+    PodcastSQLManager *m_sqlmanager;
+    QHash<int, QByteArray> m_roles;
+};
+
+#endif // PODCASTSEARCHMODEL_H
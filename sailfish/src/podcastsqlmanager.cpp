@@ -15,9 +15,15 @@
  * You should have received a copy of the GNU General Public License
  * along with Podcatcher for Sailfish OS.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <QCoreApplication>
 #include <QDir>
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QRegExp>
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QSqlRecord>
+#include <QStringList>
 #include <QString>
 #include <QVariant>
 
@@ -26,6 +32,120 @@
 #include "podcastglobals.h"
 #include "podcastsqlmanager.h"
 
+// The schema version stored in PRAGMA user_version. Bump it and add a step to
+// migrateSchemaTo() when the schema changes.
+static const int SchemaVersion = 10;
+
+// How long a connection waits for a lock, in milliseconds. In WAL mode
+// readers are only blocked by the migrations and by checkpoint recovery.
+static const int BusyTimeout = 5000;
+
+// How long episode updates are collected before they are written in one
+// transaction, in milliseconds.
+static const int EpisodeUpdateFlushInterval = 300;
+
+// The queries run for every channel or every refresh. checkQueryPlans() checks
+// that none of them needs a full table scan.
+static const char *ChannelsQuery = "SELECT id, title, description, logo, rssurl, unplayedEpisodes, autoDownloadOn, downloadedEpisodes, totalEpisodes "
+                                   "FROM channels ORDER BY channels.title";
+static const char *ChannelByIdQuery = "SELECT title, description, logo, rssurl, unplayedEpisodes, autoDownloadOn, downloadedEpisodes, totalEpisodes "
+                                      "FROM channels WHERE channels.id = :id";
+static const char *ChannelExistsQuery = "SELECT COUNT(id) FROM channels WHERE rssurl=:url";
+static const char *EpisodesQuery = "SELECT id, title, downloadLink, playLocation, preview, published, duration, downloadSize, channelid, lastPlayed, hasBeenCanceled "
+                                   "FROM episodes WHERE episodes.channelid = :chanId "
+                                   "ORDER BY episodes.published DESC, episodes.id DESC LIMIT :limit";
+// The next page after the episode with :published and :id, in the same order.
+static const char *EpisodesAfterQuery = "SELECT id, title, downloadLink, playLocation, preview, published, duration, downloadSize, channelid, lastPlayed, hasBeenCanceled "
+                                        "FROM episodes WHERE episodes.channelid = :chanId "
+                                        "AND episodes.published <= :published AND (episodes.published < :published OR episodes.id < :id) "
+                                        "ORDER BY episodes.published DESC, episodes.id DESC LIMIT :limit";
+static const char *LatestEpisodeQuery = "SELECT published FROM episodes WHERE episodes.channelid = :chanId ORDER BY episodes.published DESC LIMIT 1";
+// The links of the episodes of the channel, and of the ones deleted from it.
+static const char *EpisodeLinksQuery = "SELECT downloadLink FROM episodes WHERE episodes.channelid = :chanId "
+                                       "UNION SELECT downloadLink FROM deleted_episodes WHERE deleted_episodes.channelid = :chanId";
+// The episodes of the channel after the newest :keep ones, for the cleanup.
+static const char *OldEpisodesQuery = "SELECT id, playLocation, lastPlayed FROM episodes WHERE episodes.channelid = :chanId "
+                                      "ORDER BY episodes.published DESC, episodes.id DESC LIMIT -1 OFFSET :keep";
+static const char *DeleteChannelEpisodesQuery = "DELETE FROM episodes WHERE episodes.channelId = :chanId";
+static const char *EpisodeDescriptionQuery = "SELECT description FROM episode_descriptions WHERE episodeid = :id";
+static const char *EpisodeSearchQuery = "SELECT episodes.id, episodes.channelid, episodes.title, channels.title, episodes.preview, episodes.published "
+                                        "FROM episodes_search "
+                                        "JOIN episodes ON episodes.id = episodes_search.rowid "
+                                        "JOIN channels ON channels.id = episodes.channelid "
+                                        "WHERE episodes_search MATCH :match "
+                                        "ORDER BY bm25(episodes_search, 10.0, 1.0, 5.0) LIMIT :limit";
+static const char *NewestEpisodesQuery = "SELECT episodes.id, episodes.channelid, episodes.title, channels.title, episodes.preview, episodes.published "
+                                         "FROM episodes "
+                                         "JOIN channels ON channels.id = episodes.channelid "
+                                         "ORDER BY episodes.published DESC, episodes.id DESC LIMIT :limit";
+
+// The writes run for every episode.
+static const char *ChannelInsertQuery = "INSERT INTO channels(rssurl, title, description, logo, autoDownloadOn) VALUES (:url, :title, :desc, :logo, :autoDownloadOn)";
+static const char *EpisodeInsertQuery = "INSERT INTO episodes (title, channelid, downloadLink, playLocation, preview, published, duration, downloadSize, lastPlayed, hasBeenCanceled) VALUES "
+                                        "(:title, :channelid, :downloadLink, :playLocation, :preview, :published, :duration, :downloadSize, :lastPlayed, :hasBeenCanceled)";
+static const char *EpisodeDescriptionSaveQuery = "INSERT OR REPLACE INTO episode_descriptions (episodeid, description) VALUES (:id, :description)";
+// The link is kept before the episode is deleted, see removePodcastsFromDB().
+static const char *DeletedEpisodeInsertQuery = "INSERT OR IGNORE INTO deleted_episodes (channelid, downloadLink) "
+                                               "SELECT channelid, downloadLink FROM episodes WHERE episodes.id = :id AND downloadLink <> ''";
+static const char *EpisodeDeleteQuery = "DELETE FROM episodes WHERE episodes.id = :id";
+static const char *EpisodeSearchInsertQuery = "INSERT INTO episodes_search (rowid, title, description, channel) "
+                                              "SELECT :id, :title, :description, title FROM channels WHERE id = :channelid";
+
+// Search words shorter than this are matched as whole words, longer ones as
+// prefixes. A short prefix matches most of the library and ranking all of
+// the matches is slow.
+static const int MinimumPrefixLength = 3;
+
+// zlib level of the stored descriptions. They are written once and read
+// rarely, so the best compression is worth the time.
+static const int DescriptionCompressionLevel = 9;
+
+/**
+ * Descriptions are stored as zlib compressed UTF-8 blobs. The HTML show notes
+ * compress to a fraction of their size.
+ */
+static QByteArray compressDescription(const QString &description)
+{
+    return qCompress(description.toUtf8(), DescriptionCompressionLevel);
+}
+
+static QString uncompressDescription(const QVariant &value)
+{
+    // Rows are only text before the migration to schema version 7.
+    if (value.type() == QVariant::String) {
+        return value.toString();
+    }
+
+    return QString::fromUtf8(qUncompress(value.toByteArray()));
+}
+
+/**
+ * Returns the statement for the query from the cache of a connection, and
+ * prepares it on first use. The returned QSqlQuery shares the compiled
+ * statement with the cache. SELECTs have to be finish()ed after use, so
+ * that they do not keep a read transaction open.
+ */
+static QSqlQuery cachedStatement(QHash<QString, QSqlQuery> &statements,
+                                 const QSqlDatabase &connection,
+                                 const QString &query)
+{
+    QHash<QString, QSqlQuery>::const_iterator statement = statements.constFind(query);
+    if (statement != statements.constEnd()) {
+        return statement.value();
+    }
+
+    QSqlQuery q(connection);
+    q.setForwardOnly(true);
+    if (!q.prepare(query)) {
+        qWarning() << "SQL error: " << q.lastError().text();
+        qWarning() << "SQL query:" << query;
+        return q;
+    }
+
+    statements.insert(query, q);
+    return q;
+}
+
 PodcastSQLManager* PodcastSQLManagerFactory::m_instance = 0;
 PodcastSQLManagerFactory::PodcastSQLManagerFactory()
 {
@@ -40,8 +160,34 @@ PodcastSQLManager* PodcastSQLManagerFactory::sqlmanager() {
 }
 
 
+/**
+ * A read connection of one thread and its prepared statements. QThreadStorage
+ * deletes it when the thread finishes.
+ */
+class PodcastSQLReaderConnection
+{
+public:
+    explicit PodcastSQLReaderConnection(const QString &name) : m_name(name) {}
+    ~PodcastSQLReaderConnection() {
+        m_statements.clear();
+        {
+            QSqlDatabase connection = QSqlDatabase::database(m_name, false);
+            connection.close();
+        }
+        QSqlDatabase::removeDatabase(m_name);
+    }
+
+    QString name() const { return m_name; }
+    QHash<QString, QSqlQuery> &statements() { return m_statements; }
+
+private:
+    QString m_name;
+    QHash<QString, QSqlQuery> m_statements;
+};
+
 PodcastSQLManager::PodcastSQLManager(QObject *parent) :
-    QObject(parent)
+    QObject(parent),
+    m_writer(0)
 {
     QString databasePath;
     databasePath = PODCATCHER_PATH;
@@ -52,43 +198,441 @@ PodcastSQLManager::PodcastSQLManager(QObject *parent) :
         dirpath.mkpath(databasePath);
     }
 
-    m_connection = QSqlDatabase::addDatabase("QSQLITE");
-    m_connection.setDatabaseName(databasePath + "/" + "podcatcher.sql");
+    m_databaseFile = databasePath + "/" + "podcatcher.sql";
 
-    if (!m_connection.open()) {
+    // The types passed to the writer thread.
+    qRegisterMetaType<PodcastChannel *>("PodcastChannel*");
+    qRegisterMetaType<PodcastEpisode *>("PodcastEpisode*");
+    qRegisterMetaType<QList<PodcastChannel *> >("QList<PodcastChannel*>");
+    qRegisterMetaType<QList<PodcastEpisode *> >("QList<PodcastEpisode*>");
+    qRegisterMetaType<PodcastChannelEpisodes>("PodcastChannelEpisodes");
+    qRegisterMetaType<QList<int> >("QList<int>");
+
+    m_episodeUpdateTimer.setSingleShot(true);
+    m_episodeUpdateTimer.setInterval(EpisodeUpdateFlushInterval);
+    connect(&m_episodeUpdateTimer, SIGNAL(timeout()),
+            this, SLOT(onEpisodeUpdateTimeout()));
+
+    m_writer = new PodcastSQLWriter;
+    m_writer->moveToThread(&m_writerThread);
+    m_writerThread.start();
+
+    if (QCoreApplication::instance() != 0) {
+        connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()),
+                this, SLOT(onAboutToQuit()));
+    }
+
+    // The writer creates the database and migrates the schema before anything is read.
+    bool opened = false;
+    QMetaObject::invokeMethod(m_writer, "open", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, opened),
+                              Q_ARG(QString, m_databaseFile));
+    if (!opened) {
         qWarning() << "Could not open database with path " << databasePath;
         return;
     }
 
-    createTables();
+#ifdef QT_DEBUG
+    // A new query or schema change that makes a hot query scan a whole
+    // table fails here, in debug builds. The warnings name the query.
+    bool noTableScans = checkQueryPlans();
+    Q_ASSERT_X(noTableScans, "PodcastSQLManager", "a hot query does a full table scan");
+#endif
+}
+
+void PodcastSQLManager::onAboutToQuit()
+{
+    // Write the pending episode updates, let the queued writes finish and
+    // close the database, so that the WAL is checkpointed into the database file.
+    m_episodeUpdateTimer.stop();
+    flushEpisodeUpdates(false);
+    QMetaObject::invokeMethod(m_writer, "close", writerConnectionType());
+    m_writerThread.quit();
+    m_writerThread.wait();
+}
+
+/**
+ * The read-only connection of the calling thread. It is opened on the first
+ * read in each thread.
+ */
+QSqlDatabase PodcastSQLManager::readConnection()
+{
+    if (m_readerConnections.hasLocalData()) {
+        return QSqlDatabase::database(m_readerConnections.localData()->name());
+    }
+
+    QString name = QString("podcatcher-reader-%1").arg(quintptr(QThread::currentThreadId()), 0, 16);
+    m_readerConnections.setLocalData(new PodcastSQLReaderConnection(name));
+
+    QSqlDatabase connection = QSqlDatabase::addDatabase("QSQLITE", name);
+    connection.setDatabaseName(m_databaseFile);
+    connection.setConnectOptions(QString("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=%1").arg(BusyTimeout));
+    if (!connection.open()) {
+        qWarning() << "Could not open DB read connection:" << connection.lastError().text();
+    }
+
+    qDebug() << "Opened DB read connection" << name;
+    return connection;
+}
+
+QSqlQuery PodcastSQLManager::readStatement(const QString &query)
+{
+    QSqlDatabase connection = readConnection();
+    return cachedStatement(m_readerConnections.localData()->statements(), connection, query);
+}
+
+/**
+ * Writes block the calling thread until the writer thread has committed
+ * them. In the writer thread itself, and after the writer has been stopped
+ * at exit, they are called directly so they can not wait forever.
+ */
+Qt::ConnectionType PodcastSQLManager::writerConnectionType() const
+{
+    if (QThread::currentThread() == &m_writerThread || !m_writerThread.isRunning()) {
+        return Qt::DirectConnection;
+    }
+
+    return Qt::BlockingQueuedConnection;
+}
 
+/**
+ * Tells the channels in memory about a change in their episode counters.
+ * It is the same change that the triggers make to the counters in the DB.
+ */
+void PodcastSQLManager::updateEpisodeCounters(int channelId, int unplayedDelta, int downloadedDelta, int totalDelta)
+{
+    if (unplayedDelta != 0 || downloadedDelta != 0 || totalDelta != 0) {
+        emit episodeCountersChanged(channelId, unplayedDelta, downloadedDelta, totalDelta);
+    }
 }
 
 int PodcastSQLManager::podcastChannelToDB(PodcastChannel *channel)
+{
+    int rows = 0;
+    QMetaObject::invokeMethod(m_writer, "podcastChannelToDB", writerConnectionType(),
+                              Q_RETURN_ARG(int, rows),
+                              Q_ARG(PodcastChannel*, channel));
+    return rows;
+}
+
+int PodcastSQLManager::podcastEpisodesToDB(QList<PodcastEpisode *> parsedEpisodes, int channelid)
+{
+    int rows = 0;
+    QMetaObject::invokeMethod(m_writer, "podcastEpisodesToDB", writerConnectionType(),
+                              Q_RETURN_ARG(int, rows),
+                              Q_ARG(QList<PodcastEpisode*>, parsedEpisodes),
+                              Q_ARG(int, channelid));
+
+    // Only the episodes that got a DB id were saved.
+    int unplayed = 0;
+    int downloaded = 0;
+    int saved = 0;
+    foreach(PodcastEpisode *episode, parsedEpisodes) {
+        if (episode->dbid() < 1) {
+            continue;
+        }
+
+        unplayed += episode->isUnplayed();
+        downloaded += episode->isDownloaded();
+        saved++;
+        episode->setSavedToDB();
+    }
+    updateEpisodeCounters(channelid, unplayed, downloaded, saved);
+
+    return rows;
+}
+
+QList<PodcastChannel *> PodcastSQLManager::importChannelsToDB(const QList<PodcastChannel *> &channels,
+                                                              const PodcastChannelEpisodes &episodes)
+{
+    QList<PodcastChannel *> savedChannels;
+    QMetaObject::invokeMethod(m_writer, "importChannelsToDB", writerConnectionType(),
+                              Q_RETURN_ARG(QList<PodcastChannel*>, savedChannels),
+                              Q_ARG(QList<PodcastChannel*>, channels),
+                              Q_ARG(PodcastChannelEpisodes, episodes));
+
+    // The channels are new, so their counters are just their imported episodes.
+    // Imported episodes are saved as never played.
+    foreach(PodcastChannel *channel, savedChannels) {
+        int downloaded = 0;
+        int saved = 0;
+        foreach(PodcastEpisode *episode, episodes.value(channel)) {
+            if (episode->dbid() < 1) {
+                continue;
+            }
+
+            downloaded += episode->isDownloaded();
+            saved++;
+            episode->setSavedToDB();
+        }
+        channel->setEpisodeCounters(downloaded, downloaded, saved);
+    }
+
+    return savedChannels;
+}
+
+/**
+ * Deletes the episodes from the DB in one transaction. The channel counters
+ * and episodesRemoved() are updated once for all of them.
+ */
+bool PodcastSQLManager::removePodcastsFromDB(const QList<PodcastEpisodeData> &episodes)
+{
+    if (episodes.isEmpty()) {
+        return true;
+    }
+
+    QList<int> episodeIds;
+    m_episodeUpdatesMutex.lock();
+    foreach(const PodcastEpisodeData &episode, episodes) {
+        m_episodeUpdates.remove(episode.dbid);
+        episodeIds << episode.dbid;
+    }
+    m_episodeUpdatesMutex.unlock();
+
+    bool removed = false;
+    QMetaObject::invokeMethod(m_writer, "removePodcastsFromDB", writerConnectionType(),
+                              Q_RETURN_ARG(bool, removed),
+                              Q_ARG(QList<int>, episodeIds));
+
+    if (!removed) {
+        return false;
+    }
+
+    QMap<int, int> unplayed;
+    QMap<int, int> downloaded;
+    QMap<int, int> total;
+    foreach(const PodcastEpisodeData &episode, episodes) {
+        unplayed[episode.channelid] += episode.savedAsUnplayed;
+        downloaded[episode.channelid] += episode.savedAsDownloaded;
+        total[episode.channelid]++;
+    }
+
+    foreach(int channelId, total.keys()) {
+        updateEpisodeCounters(channelId, -unplayed.value(channelId), -downloaded.value(channelId), -total.value(channelId));
+    }
+    emit episodesRemoved(episodeIds);
+
+    return true;
+}
+
+bool PodcastSQLManager::updateChannelInDB(PodcastChannel *channel)
+{
+    bool updated = false;
+    QMetaObject::invokeMethod(m_writer, "updateChannelInDB", writerConnectionType(),
+                              Q_RETURN_ARG(bool, updated),
+                              Q_ARG(PodcastChannel*, channel));
+    return updated;
+}
+
+/**
+ * Queues the changed fields of the episode to be written to the DB. The
+ * updates are collected for EpisodeUpdateFlushInterval ms and then written
+ * in one transaction, so updating many episodes at once is one commit.
+ */
+void PodcastSQLManager::updatePodcastInDB(PodcastEpisodeData &episode)
+{
+    int dirtyFields = episode.dirtyFields;
+    if (dirtyFields == 0 || episode.dbid < 1) {
+        return;
+    }
+
+    // The values are taken now, the episode may be gone by the time they are written.
+    QVariantMap columns;
+    if (dirtyFields & PodcastEpisode::TitleField) {
+        columns.insert("title", episode.title);
+    }
+    if (dirtyFields & PodcastEpisode::DownloadLinkField) {
+        columns.insert("downloadLink", episode.downloadLink);
+    }
+    if (dirtyFields & PodcastEpisode::PlayFilenameField) {
+        columns.insert("playLocation", episode.playFilename);
+    }
+    if (dirtyFields & PodcastEpisode::PubTimeField) {
+        columns.insert("published", episode.published);  // NOTE: We save the seconds since EPOC for easier handling.
+    }
+    if (dirtyFields & PodcastEpisode::DurationField) {
+        columns.insert("duration", episode.duration);
+    }
+    if (dirtyFields & PodcastEpisode::DownloadSizeField) {
+        columns.insert("downloadSize", episode.downloadSize);
+    }
+    if (dirtyFields & PodcastEpisode::LastPlayedField) {
+        columns.insert("lastPlayed", episode.lastPlayed);  // NOTE: We save the seconds since EPOC for easier handling.
+    }
+    if (dirtyFields & PodcastEpisode::CanceledField) {
+        columns.insert("hasBeenCanceled", episode.hasBeenCanceled);
+    }
+
+    m_episodeUpdatesMutex.lock();
+    QVariantMap &pendingColumns = m_episodeUpdates[episode.dbid];
+    for (QVariantMap::const_iterator column = columns.constBegin(); column != columns.constEnd(); ++column) {
+        pendingColumns.insert(column.key(), column.value());
+    }
+    m_episodeUpdatesMutex.unlock();
+
+    updateEpisodeCounters(episode.channelid,
+                          episode.isUnplayed() - episode.savedAsUnplayed,
+                          episode.isDownloaded() - episode.savedAsDownloaded,
+                          0);
+    episode.setSavedToDB();
+
+    // The timer lives in the thread of the manager.
+    QMetaObject::invokeMethod(&m_episodeUpdateTimer, "start");
+}
+
+/**
+ * Hands the pending episode updates to the writer. When wait is true,
+ * returns after the writer has committed them and everything queued
+ * before them, so that a read after this sees all earlier writes.
+ */
+void PodcastSQLManager::flushEpisodeUpdates(bool wait)
+{
+    m_episodeUpdatesMutex.lock();
+    QVariantList updates;
+    for (QMap<int, QVariantMap>::const_iterator update = m_episodeUpdates.constBegin(); update != m_episodeUpdates.constEnd(); ++update) {
+        QVariantMap columns = update.value();
+        columns.insert("id", update.key());
+        updates << columns;
+    }
+    m_episodeUpdates.clear();
+    m_episodeUpdatesMutex.unlock();
+
+    if (updates.isEmpty() && !wait) {
+        return;
+    }
+
+    Qt::ConnectionType connectionType = writerConnectionType();
+    if (!wait && connectionType == Qt::BlockingQueuedConnection) {
+        connectionType = Qt::QueuedConnection;
+    }
+
+    QMetaObject::invokeMethod(m_writer, "updateEpisodesInDB", connectionType,
+                              Q_ARG(QVariantList, updates));
+}
+
+void PodcastSQLManager::onEpisodeUpdateTimeout()
+{
+    flushEpisodeUpdates(false);
+}
+
+void PodcastSQLManager::removeChannelFromDB(int channelId)
+{
+    QMetaObject::invokeMethod(m_writer, "removeChannelFromDB", writerConnectionType(),
+                              Q_ARG(int, channelId));
+}
+
+/**
+ * Without the caching, the writer prepares every statement for each use.
+ * Only for comparing the two in PodcastTester.
+ */
+void PodcastSQLManager::setStatementCaching(bool enabled)
+{
+    QMetaObject::invokeMethod(m_writer, "setStatementCaching", writerConnectionType(),
+                              Q_ARG(bool, enabled));
+}
+
+void PodcastSQLManager::updateChannelAutoDownloadToDB(bool autoDownloadOn)
+{
+    QMetaObject::invokeMethod(m_writer, "updateChannelAutoDownloadToDB", writerConnectionType(),
+                              Q_ARG(bool, autoDownloadOn));
+}
+
+void PodcastSQLManager::checkAndCreateAutoDownload(bool autoDownloadOn)
+{
+    QMetaObject::invokeMethod(m_writer, "checkAndCreateAutoDownload", writerConnectionType(),
+                              Q_ARG(bool, autoDownloadOn));
+}
+
+PodcastSQLWriter::PodcastSQLWriter(QObject *parent) :
+    QObject(parent),
+    m_statementCaching(true),
+    m_autoDownloadColumnAdded(false),
+    m_searchIndexed(false)
+{
+}
+
+void PodcastSQLWriter::setStatementCaching(bool enabled)
+{
+    m_statementCaching = enabled;
+    m_statements.clear();
+}
+
+QSqlQuery PodcastSQLWriter::statement(const QString &query)
+{
+    if (!m_statementCaching) {
+        QHash<QString, QSqlQuery> statements;
+        return cachedStatement(statements, m_connection, query);
+    }
+
+    return cachedStatement(m_statements, m_connection, query);
+}
+
+bool PodcastSQLWriter::open(const QString &databaseFile)
+{
+    m_connection = QSqlDatabase::addDatabase("QSQLITE", "podcatcher-writer");
+    m_connection.setDatabaseName(databaseFile);
+    m_connection.setConnectOptions(QString("QSQLITE_BUSY_TIMEOUT=%1").arg(BusyTimeout));
+
+    if (!m_connection.open()) {
+        qWarning() << "Could not open database" << databaseFile << ":" << m_connection.lastError().text();
+        return false;
+    }
+
+    // In WAL mode the readers see the last commit while a write is going on.
+    // With synchronous=NORMAL a commit is not synced to disk, only checkpoints are.
+    QSqlQuery q(m_connection);
+    if (!q.exec("PRAGMA journal_mode=WAL") || !q.next() || q.value(0).toString() != "wal") {
+        qWarning() << "Could not enable WAL journal mode:" << q.lastError().text();
+    }
+    if (!q.exec("PRAGMA synchronous=NORMAL")) {
+        qWarning() << "SQL error: " << q.lastError().text();
+    }
+    q.finish();
+
+    migrateSchema();
+
+    // Without FTS5 in SQLite there is no search index, see createSearchIndex().
+    m_searchIndexed = q.exec("SELECT name FROM sqlite_master WHERE type = 'table' AND name = 'episodes_search'") && q.next();
+    q.finish();
+
+    return true;
+}
+
+void PodcastSQLWriter::close()
+{
+    m_statements.clear();
+
+    QString name = m_connection.connectionName();
+    m_connection.close();
+    m_connection = QSqlDatabase();
+    QSqlDatabase::removeDatabase(name);
+}
+
+int PodcastSQLWriter::podcastChannelToDB(PodcastChannel *channel)
 {
     if (channel == 0) {
         return 0;
     }
 
-    mutex.lock();
     if (!m_connection.isOpen()) {
         qWarning() << "SQL connection not open. Returning.";
-        mutex.unlock();
         return 0;
     }
 
-    mutex.unlock();  // isChannelInDB() is also locking...
-    if (isChannelInDB(channel)) {
+    // Checked on the writer connection, so no other write can add the channel in between.
+    QSqlQuery existsQuery = statement(ChannelExistsQuery);
+    existsQuery.bindValue(":url", channel->url());
+    bool exists = existsQuery.exec() && existsQuery.next() && existsQuery.value(0).toInt() > 0;
+    existsQuery.finish();
+    if (exists) {
         return 0;
     }
-    mutex.lock();
 
-    QSqlQuery q(m_connection);
+    QSqlQuery q = statement(ChannelInsertQuery);
 
     // Item not found in database. Go ahead and insert it.
     m_connection.transaction();
 
-    q.prepare("INSERT INTO channels(rssurl, title, description, logo, autoDownloadOn) VALUES (:url, :title, :desc, :logo, :autoDownloadOn)");
     q.bindValue(":url", channel->url());
     q.bindValue(":desc", channel->description());
     q.bindValue(":title", channel->title());
@@ -98,8 +642,6 @@ int PodcastSQLManager::podcastChannelToDB(PodcastChannel *channel)
 
     m_connection.commit();
 
-    mutex.unlock();
-
     // Update the channel with the id it got in DB
     channel->setId(q.lastInsertId().toInt());
 
@@ -108,44 +650,34 @@ int PodcastSQLManager::podcastChannelToDB(PodcastChannel *channel)
 
 bool PodcastSQLManager::isChannelInDB(PodcastChannel *channel)
 {
-    mutex.lock();
-    QSqlQuery q(m_connection);
-    mutex.unlock();
+    QSqlQuery q = readStatement(ChannelExistsQuery);
 
     // Find out if the channel is already in our DB.
     // Do not add if the channel is already there.
-    q.prepare("SELECT COUNT(id) FROM channels WHERE rssurl=:url");
     q.bindValue(":url", channel->url());
     if (!q.exec()) {
         qDebug() << Q_FUNC_INFO << q.lastError().text();
     }
 
     if (!q.next()) {
+        q.finish();
         return false; // DB is probably empty.
     }
 
-    if (q.value(0).toInt() > 0) {   // Channel already exists in the DB - do nothing.
-        return true;
-    }
+    bool channelInDB = (q.value(0).toInt() > 0);   // Channel already exists in the DB - do nothing.
+    q.finish();
 
-    return false;
+    return channelInDB;
 }
 
 QList<PodcastChannel *> PodcastSQLManager::channelsInDB()
 {
-    mutex.lock();
-    QSqlQuery q(m_connection);
-    mutex.unlock();
+    QSqlQuery q = readStatement(ChannelsQuery);
 
     QList<PodcastChannel *> channels;
 
     qDebug() << "Returning Podcast channels from DB:";
 
-    q.prepare("SELECT id, title, description, logo, rssurl, "
-              "(SELECT COUNT(id) FROM episodes WHERE episodes.channelid = channels.id AND episodes.lastPlayed = 0 AND episodes.playLocation <> ''), "
-              "autoDownloadOn "
-              "FROM channels ORDER BY channels.title");
-
     if (q.exec() == false) {
         qWarning() << "SQL error:" << q.lastError();
         qWarning() << "Last query: " << q.lastQuery();
@@ -158,32 +690,30 @@ QList<PodcastChannel *> PodcastSQLManager::channelsInDB()
         channel->setDescription(q.value(2).toString());
         channel->setLogo(q.value(3).toString());
         channel->setUrl(q.value(4).toString());
-        channel->setUnplayedEpisodes(q.value(5).toInt());
         channel->setAutoDownloadOn(q.value(6).toBool());
+        channel->setEpisodeCounters(q.value(5).toInt(), q.value(7).toInt(), q.value(8).toInt());
 
         channels.append(channel);
     }
+    q.finish();
 
     return channels;
 }
 
 PodcastChannel * PodcastSQLManager::channelInDB(int channelId, PodcastChannel *channel)
 {
-    mutex.lock();
-    QSqlQuery q(m_connection);
-    mutex.unlock();
+    flushEpisodeUpdates(true);
+
+    QSqlQuery q = readStatement(ChannelByIdQuery);
 
     qDebug() << "Returning Podcast channel from DB with id" << channelId;
 
-    q.prepare("SELECT title, description, logo, rssurl, "
-              "(SELECT COUNT(id) FROM episodes WHERE episodes.channelid = channels.id AND episodes.lastPlayed = 0 AND episodes.playLocation <> ''), "
-              "autoDownloadOn "
-              "FROM channels WHERE channels.id = :id");
     q.bindValue(":id", channelId);
     q.exec();
     if (!q.next()) {
         qWarning() << "SQL error: " << q.lastError();
         qWarning() << "Last query:" << q.lastQuery();
+        q.finish();
         return 0;
     }
 
@@ -195,155 +725,356 @@ PodcastChannel * PodcastSQLManager::channelInDB(int channelId, PodcastChannel *c
     channel->setDescription(q.value(1).toString());
     channel->setLogo(q.value(2).toString());
     channel->setUrl(q.value(3).toString());
-    channel->setUnplayedEpisodes(q.value(4).toInt());
     channel->setAutoDownloadOn(q.value(5).toBool());
+    channel->setEpisodeCounters(q.value(4).toInt(), q.value(6).toInt(), q.value(7).toInt());
+    q.finish();
 
     return channel;
 }
 
 
 
-int PodcastSQLManager::podcastEpisodesToDB(QList<PodcastEpisode *> parsedEpisodes, int channelid)
+int PodcastSQLWriter::podcastEpisodesToDB(QList<PodcastEpisode *> parsedEpisodes, int channelid)
 {
     qDebug() << "Got" << parsedEpisodes.length() << "episodes for channel" << channelid;
 
-    mutex.lock();
     if (!m_connection.isOpen()) {
         qWarning() << "SQL connection not open. Returning.";
-        mutex.unlock();
         return 0;
     }
 
-    QSqlQuery q(m_connection);
+    QSqlQuery q = statement(EpisodeInsertQuery);
     m_connection.transaction();
 
     foreach(PodcastEpisode* episode, parsedEpisodes) {
-        q.prepare("INSERT INTO episodes (title, channelid, downloadLink, playLocation, description, published, duration, downloadSize, lastPlayed, hasBeenCanceled) VALUES "
-                  "(:title, :channelid, :downloadLink, :playLocation, :description, :published, :duration, :downloadSize, :lastPlayed, :hasBeenCanceled)");
-        q.bindValue(":title", episode->title());
-        q.bindValue(":channelid", channelid);
-        q.bindValue(":downloadLink", episode->downloadLink());
-        q.bindValue(":playLocation", episode->playFilename());
-        q.bindValue(":description", episode->description());
-        q.bindValue(":published", episode->pubTime().toTime_t());  // NOTE: We save the seconds since EPOC for easier handling.
-        q.bindValue(":duration", episode->duration());
-        q.bindValue(":downloadSize", episode->downloadSize());
-        q.bindValue(":lastPlayed", episode->lastPlayed().isValid() ? episode->lastPlayed().toTime_t() : 0);  // NOTE: We save the seconds since EPOC for easier handling.
-        q.bindValue(":hasBeenCanceled", episode->hasBeenCanceled());
+        insertEpisode(q, episode, channelid);
+    }
 
-        if (!q.exec()) {
-            qDebug() << "Last query: " << q.lastQuery();
-            qDebug() << "Error: " << q.lastError();
-        }
+    if (!m_connection.commit()) {
+        qWarning() << "SQL error: " << m_connection.lastError().text();
+        m_connection.rollback();
 
-        episode->setDbId(q.lastInsertId().toInt());
-        qDebug() << "Giving episode a DB ID:" << episode->dbid();
+        // None of the episodes were saved after all.
+        foreach(PodcastEpisode* episode, parsedEpisodes) {
+            episode->setDbId(0);
+        }
+        return 0;
     }
 
-    m_connection.commit();
-    mutex.unlock();
-
     return q.numRowsAffected();
 }
 
-bool PodcastSQLManager::podcastEpisodeToDB(PodcastEpisode *episode, int channelid)
+/**
+ * Saves a batch of new channels and their episodes in one transaction. Channels
+ * that are already in the DB are skipped. Returns the channels that were saved.
+ */
+QList<PodcastChannel *> PodcastSQLWriter::importChannelsToDB(QList<PodcastChannel *> channels,
+                                                             PodcastChannelEpisodes episodes)
 {
-    if (episode == 0) {
-        return false;
-    }
+    QList<PodcastChannel *> savedChannels;
+
+    qDebug() << "Importing" << channels.size() << "channels to DB.";
 
-    mutex.lock();
     if (!m_connection.isOpen()) {
         qWarning() << "SQL connection not open. Returning.";
-        mutex.unlock();
-        return false;
+        return savedChannels;
     }
 
-    QSqlQuery q(m_connection);
-    q.prepare("INSERT INTO episodes(title, channelid, downloadLink, playLocation, description, published, duration, downloadSize, lastPlayed, hasBeenCanceled) VALUES "
-              "(:title, :channelid, :downloadLink, :playLocation, :description, :published, :duration, :downloadSize, :lastPlayed, :hasBeenCanceled)");
+    QSqlQuery existsQuery = statement(ChannelExistsQuery);
+    QSqlQuery channelQuery = statement(ChannelInsertQuery);
+    QSqlQuery episodeQuery = statement(EpisodeInsertQuery);
+
+    m_connection.transaction();
+
+    foreach(PodcastChannel *channel, channels) {
+        existsQuery.bindValue(":url", channel->url());
+        bool exists = existsQuery.exec() && existsQuery.next() && existsQuery.value(0).toInt() > 0;
+        existsQuery.finish();
+        if (exists) {
+            qDebug() << "Channel" << channel->url() << "is already in DB. Not importing it.";
+            continue;
+        }
+
+        channelQuery.bindValue(":url", channel->url());
+        channelQuery.bindValue(":desc", channel->description());
+        channelQuery.bindValue(":title", channel->title());
+        channelQuery.bindValue(":logo", channel->logo());
+        channelQuery.bindValue(":autoDownloadOn", channel->isAutoDownloadOn());
+
+        if (!channelQuery.exec()) {
+            qWarning() << "SQL error:" << channelQuery.lastError();
+            continue;
+        }
+
+        channel->setId(channelQuery.lastInsertId().toInt());
+
+        // Oldest episode first, like podcastEpisodesToDB() gets them from the episodes model.
+        QList<PodcastEpisode *> channelEpisodes = episodes.value(channel);
+        for (int i=channelEpisodes.size()-1; i>=0; i--) {
+            insertEpisode(episodeQuery, channelEpisodes.at(i), channel->channelDbId());
+        }
+
+        savedChannels.append(channel);
+    }
+
+    if (!m_connection.commit()) {
+        qWarning() << "SQL error: " << m_connection.lastError().text();
+        m_connection.rollback();
+        savedChannels.clear();
+
+        foreach(PodcastChannel *channel, channels) {
+            foreach(PodcastEpisode *episode, episodes.value(channel)) {
+                episode->setDbId(0);
+            }
+        }
+    }
+
+    qDebug() << "Imported" << savedChannels.size() << "channels to DB.";
+    return savedChannels;
+}
+
+/**
+ * Inserts a new episode with the prepared EpisodeInsertQuery, and its
+ * description and search index entry. The episode gets its DB id.
+ */
+bool PodcastSQLWriter::insertEpisode(QSqlQuery &q, PodcastEpisode *episode, int channelid)
+{
     q.bindValue(":title", episode->title());
     q.bindValue(":channelid", channelid);
     q.bindValue(":downloadLink", episode->downloadLink());
     q.bindValue(":playLocation", episode->playFilename());
-    q.bindValue(":description", episode->description());
+    q.bindValue(":preview", episode->preview());
     q.bindValue(":published", episode->pubTime().toTime_t());  // NOTE: We save the seconds since EPOC for easier handling.
     q.bindValue(":duration", episode->duration());
     q.bindValue(":downloadSize", episode->downloadSize());
-
-    QDateTime lastPlayed = episode->lastPlayed();
-    if (lastPlayed.isValid()) {
-        q.bindValue(":lastPlayed", episode->lastPlayed().toTime_t());
-    } else {
-        q.bindValue(":lastPlayed", 0);
-    }
-
+    q.bindValue(":lastPlayed", episode->lastPlayed().isValid() ? episode->lastPlayed().toTime_t() : 0);  // NOTE: We save the seconds since EPOC for easier handling.
     q.bindValue(":hasBeenCanceled", episode->hasBeenCanceled());
 
     if (!q.exec()) {
         qDebug() << "Last query: " << q.lastQuery();
         qDebug() << "Error: " << q.lastError();
-        mutex.unlock();
         return false;
     }
 
-    mutex.unlock();
+    episode->setDbId(q.lastInsertId().toInt());
+    qDebug() << "Giving episode a DB ID:" << episode->dbid();
+
+    saveEpisodeDescription(episode->dbid(), episode->description());
+    indexEpisode(episode->dbid(), channelid, episode->title(), episode->description());
     return true;
 }
 
-QList<PodcastEpisode *> PodcastSQLManager::episodesInDB(int channelId)
+/**
+ * Descriptions are in a table of their own, so that listing the episodes
+ * does not read them. Only the short preview is in the episodes table.
+ */
+bool PodcastSQLWriter::saveEpisodeDescription(int episodeId, const QString &description)
 {
-    mutex.lock();
-    QSqlQuery q(m_connection);
-    mutex.unlock();
-
-    QList<PodcastEpisode *> episodes;
-
-    qDebug() << "Returning Podcast episodes from DB for channel:" << channelId;
+    if (description.isEmpty()) {
+        return true;
+    }
 
-    q.prepare("SELECT id, title, downloadLink, playLocation, description, published, duration, downloadSize, channelid, lastPlayed, hasBeenCanceled "
-              "FROM episodes WHERE episodes.channelid = :chanId ORDER BY episodes.published DESC");
-    q.bindValue(":chanId", channelId);
+    QSqlQuery q = statement(EpisodeDescriptionSaveQuery);
+    q.bindValue(":id", episodeId);
+    q.bindValue(":description", compressDescription(description));
 
     if (!q.exec()) {
-        qWarning() << "Fetching episodes, SQL error: " << q.lastError();
-        qWarning() << "Last query:" << q.lastQuery();
-        return episodes;
+        qDebug() << "Last query: " << q.lastQuery();
+        qDebug() << "Error: " << q.lastError();
+        return false;
     }
 
-    while (q.next()) {
-        PodcastEpisode *episode = new PodcastEpisode;
-        episode->setDbId(q.value(0).toInt());
-        episode->setTitle(q.value(1).toString());
-        episode->setDownloadLink(q.value(2).toString());
-        episode->setPlayFilename(q.value(3).toString());
-        episode->setDescription(q.value(4).toString());
-        episode->setPubTime(QDateTime::fromTime_t(q.value(5).toInt()));
-        episode->setDuration(q.value(6).toString());
-        episode->setDownloadSize(q.value(7).toInt());
-        if (q.value(9).toInt() > 0) {
-            episode->setLastPlayed(QDateTime::fromTime_t(q.value(9).toInt()));
-        }
-        episode->setHasBeenCanceled(q.value(10).toBool());
-
+    return true;
+}
+
+/**
+ * Adds the episode to the search index. Deleted episodes are removed from
+ * the index by a trigger.
+ */
+void PodcastSQLWriter::indexEpisode(int episodeId, int channelId, const QString &title, const QString &description)
+{
+    if (!m_searchIndexed) {
+        return;
+    }
+
+    QSqlQuery q = statement(EpisodeSearchInsertQuery);
+    q.bindValue(":id", episodeId);
+    q.bindValue(":title", title);
+    q.bindValue(":description", PodcastEpisode::plainText(description));
+    q.bindValue(":channelid", channelId);
+
+    if (!q.exec()) {
+        qDebug() << "Last query: " << q.lastQuery();
+        qDebug() << "Error: " << q.lastError();
+    }
+}
+
+/**
+ * One page of the episodes of the channel, newest first. The page starts
+ * after the episode given as after, or with the newest episode. Paging by
+ * the (published, id) of the last episode is a range scan of the index, so
+ * every page is as fast as the first.
+ */
+QVector<PodcastEpisodeData> PodcastSQLManager::episodesInDB(int channelId, int limit, const PodcastEpisodeData *after)
+{
+    flushEpisodeUpdates(true);
+
+    QSqlQuery q = readStatement(after == 0 ? EpisodesQuery : EpisodesAfterQuery);
+
+    QVector<PodcastEpisodeData> episodes;
+
+    qDebug() << "Returning Podcast episodes from DB for channel:" << channelId;
+
+    q.bindValue(":chanId", channelId);
+    q.bindValue(":limit", limit);
+    if (after != 0) {
+        q.bindValue(":published", after->published);
+        q.bindValue(":id", after->dbid);
+    }
+
+    if (!q.exec()) {
+        qWarning() << "Fetching episodes, SQL error: " << q.lastError();
+        qWarning() << "Last query:" << q.lastQuery();
+        return episodes;
+    }
+
+    episodes.reserve(limit);
+    while (q.next()) {
+        PodcastEpisodeData episode;
+        episode.dbid = q.value(0).toInt();
+        episode.title = q.value(1).toString();
+        episode.downloadLink = q.value(2).toString();
+        episode.playFilename = q.value(3).toString();
+        episode.preview = q.value(4).toString();
+        episode.published = q.value(5).toUInt();
+        episode.duration = q.value(6).toString();
+        episode.downloadSize = q.value(7).toLongLong();
+        episode.lastPlayed = q.value(9).toUInt();
+        episode.setHasBeenCanceled(q.value(10).toBool());
+
         // Since we requested channels for this channel, we might as well be sure the value is what we requested as parameter.
-        episode->setChannelId(channelId);
+        episode.channelid = channelId;
+        episode.setSavedToDB();
 
         episodes.append(episode);
     }
+    q.finish();
 
     qDebug() << "Fetched" << episodes.size() << "episodes.";
     return episodes;
 }
 
+/**
+ * The full description of an episode. Episodes read from the DB only have
+ * the preview, the description is read when it is shown.
+ */
+QString PodcastSQLManager::episodeDescriptionInDB(int episodeId)
+{
+    flushEpisodeUpdates(true);
+
+    QSqlQuery q = readStatement(EpisodeDescriptionQuery);
+    q.bindValue(":id", episodeId);
+
+    QString description;
+    if (!q.exec()) {
+        qWarning() << "SQL error: " << q.lastError();
+        qWarning() << "SQL query: " << q.lastQuery();
+    } else if (q.next()) {
+        description = uncompressDescription(q.value(0));
+    }
+    q.finish();
+
+    return description;
+}
+
+/**
+ * Searches the titles and descriptions of the episodes and the titles of
+ * their channels. Every word of the text has to match, the words as
+ * prefixes. The best matches come first, a match in the title counts the most.
+ */
+QList<PodcastEpisodeSummary> PodcastSQLManager::searchEpisodesInDB(const QString &text, int limit)
+{
+    QList<PodcastEpisodeSummary> results;
+
+    // Everything but the words is dropped, so the text can not contain FTS5 syntax.
+    QStringList terms;
+    foreach(QString word, text.split(QRegExp("\\W+"), QString::SkipEmptyParts)) {
+        if (word.length() < MinimumPrefixLength) {
+            terms << QString("\"%1\"").arg(word);
+        } else {
+            terms << QString("\"%1\"*").arg(word);
+        }
+    }
+
+    if (terms.isEmpty()) {
+        return results;
+    }
+
+    QSqlQuery q = readStatement(EpisodeSearchQuery);
+    q.bindValue(":match", terms.join(" "));
+    q.bindValue(":limit", limit);
+
+    if (!q.exec()) {
+        qWarning() << "SQL error: " << q.lastError();
+        qWarning() << "SQL query: " << q.lastQuery();
+        return results;
+    }
+
+    results = episodeSummaries(q);
+    q.finish();
+
+    return results;
+}
+
+/**
+ * The newest episodes of all channels, newest first. They are read from
+ * the index on the publishing time, without sorting all the episodes.
+ */
+QList<PodcastEpisodeSummary> PodcastSQLManager::newestEpisodesInDB(int limit)
+{
+    flushEpisodeUpdates(true);
+
+    QSqlQuery q = readStatement(NewestEpisodesQuery);
+    q.bindValue(":limit", limit);
+
+    QList<PodcastEpisodeSummary> episodes;
+    if (!q.exec()) {
+        qWarning() << "SQL error: " << q.lastError();
+        qWarning() << "SQL query: " << q.lastQuery();
+        return episodes;
+    }
+
+    episodes = episodeSummaries(q);
+    q.finish();
+
+    return episodes;
+}
+
+/**
+ * Reads the rows of a query that selects the episode id, channel id,
+ * episode title, channel title, preview and publishing time.
+ */
+QList<PodcastEpisodeSummary> PodcastSQLManager::episodeSummaries(QSqlQuery &q)
+{
+    QList<PodcastEpisodeSummary> episodes;
+    while (q.next()) {
+        PodcastEpisodeSummary episode;
+        episode.episodeId = q.value(0).toInt();
+        episode.channelId = q.value(1).toInt();
+        episode.title = q.value(2).toString();
+        episode.channelTitle = q.value(3).toString();
+        episode.preview = q.value(4).toString();
+        episode.published = QDateTime::fromTime_t(q.value(5).toInt());
+        episodes.append(episode);
+    }
+
+    return episodes;
+}
+
 QDateTime PodcastSQLManager::latestEpisodeTimestampInDB(int channelId)
 {
     QDateTime latestDate = QDateTime();
-    mutex.lock();
-    QSqlQuery q(m_connection);
-    mutex.unlock();
-
-    q.prepare("SELECT published FROM episodes WHERE episodes.channelid = :chanId ORDER BY episodes.published DESC LIMIT 1");
+    QSqlQuery q = readStatement(LatestEpisodeQuery);
     q.bindValue(":chanId", channelId);
 
     if (q.exec()) {
@@ -357,21 +1088,86 @@ QDateTime PodcastSQLManager::latestEpisodeTimestampInDB(int channelId)
         qWarning() << "SQL error: " << q.lastError();
         qWarning() << "SQL query: " << q.lastQuery();
     }
+    q.finish();
 
     return latestDate;
 }
 
-bool PodcastSQLManager::updateChannelInDB(PodcastChannel *channel) {
+/**
+ * The download links of the episodes of the channel in the DB, and of the
+ * episodes that have been deleted from it. A refresh does not add the
+ * episodes with these links again.
+ */
+QSet<QString> PodcastSQLManager::episodeLinksInDB(int channelId)
+{
+    flushEpisodeUpdates(true);
+
+    QSet<QString> links;
+    QSqlQuery q = readStatement(EpisodeLinksQuery);
+    q.bindValue(":chanId", channelId);
+
+    if (!q.exec()) {
+        qWarning() << "SQL error: " << q.lastError();
+        qWarning() << "SQL query: " << q.lastQuery();
+        return links;
+    }
+
+    while (q.next()) {
+        links.insert(q.value(0).toString());
+    }
+    q.finish();
+
+    return links;
+}
+
+/**
+ * The episodes of the channel that the cleanup removes: all but the newest
+ * keepNumEpisodes, without the unplayed downloads when keepUnplayed is set.
+ * Only the fields needed to delete them are read. Can be called from any
+ * thread.
+ */
+QList<PodcastEpisodeData> PodcastSQLManager::oldEpisodesInDB(int channelId, int keepNumEpisodes, bool keepUnplayed)
+{
+    flushEpisodeUpdates(true);
+
+    QList<PodcastEpisodeData> episodes;
+    QSqlQuery q = readStatement(OldEpisodesQuery);
+    q.bindValue(":chanId", channelId);
+    q.bindValue(":keep", keepNumEpisodes);
+
+    if (!q.exec()) {
+        qWarning() << "SQL error: " << q.lastError();
+        qWarning() << "SQL query: " << q.lastQuery();
+        return episodes;
+    }
+
+    while (q.next()) {
+        PodcastEpisodeData episode;
+        episode.dbid = q.value(0).toInt();
+        episode.channelid = channelId;
+        episode.playFilename = q.value(1).toString();
+        episode.lastPlayed = q.value(2).toUInt();
+        episode.setSavedToDB();
+
+        if (keepUnplayed && episode.isUnplayed()) {
+            continue;
+        }
+
+        episodes << episode;
+    }
+    q.finish();
+
+    return episodes;
+}
+
+bool PodcastSQLWriter::updateChannelInDB(PodcastChannel *channel) {
     qDebug() << "Updating podcast channel data to DB";
-    mutex.lock();
     if (!m_connection.isOpen()) {
-        mutex.unlock();
         qWarning() << "SQL connection not open. Returning.";
         return false;
     }
 
     QSqlQuery q(m_connection);
-    mutex.unlock();
 
     q.prepare("UPDATE channels SET title=:title, description=:description, logo=:logo, rssurl=:rssurl, autoDownloadOn=:autoDownloadOn "
               "WHERE id=:id");
@@ -385,59 +1181,99 @@ bool PodcastSQLManager::updateChannelInDB(PodcastChannel *channel) {
     if (!q.exec()) {
         qDebug() << "Last query: " << q.lastQuery();
         qDebug() << "Error: " << q.lastError();
-        mutex.unlock();
         return false;
     }
 
-    mutex.unlock();
+    // The channel title is in the search index of each of its episodes.
+    if (m_searchIndexed) {
+        q.prepare("UPDATE episodes_search SET channel = :title "
+                  "WHERE rowid IN (SELECT id FROM episodes WHERE channelid = :id) AND channel <> :title");
+        q.bindValue(":title", channel->title());
+        q.bindValue(":id", channel->channelDbId());
+        if (!q.exec()) {
+            qDebug() << "Last query: " << q.lastQuery();
+            qDebug() << "Error: " << q.lastError();
+        }
+    }
+
     return true;
 }
 
-void PodcastSQLManager::updatePodcastInDB(PodcastEpisode *episode)
+/**
+ * Writes a batch of episode updates in one transaction. Each update is a
+ * map of the changed columns and the "id" of the episode.
+ */
+void PodcastSQLWriter::updateEpisodesInDB(QVariantList updates)
 {
-    qDebug() << "Updating episode data to DB";
-    mutex.lock();
+    if (updates.isEmpty()) {
+        return;
+    }
+
+    qDebug() << "Updating" << updates.size() << "episodes to DB";
     if (!m_connection.isOpen()) {
-        mutex.unlock();
         qWarning() << "SQL connection not open. Returning.";
         return;
     }
 
-    QSqlQuery q(m_connection);
-    mutex.unlock();
+    m_connection.transaction();
 
-    q.prepare("UPDATE episodes SET title=:title, downloadLink=:downloadLink, playLocation=:playLocation, description=:description, "
-              "published=:published, duration=:duration, downloadSize=:downloadSize, lastPlayed=:lastPlayed, hasBeenCanceled=:hasBeenCanceled "
-              "WHERE id=:id");
-    q.bindValue(":title", episode->title());
-    q.bindValue(":downloadLink", episode->downloadLink());
-    q.bindValue(":playLocation", episode->playFilename());
-    q.bindValue(":description", episode->description());
-    q.bindValue(":published", episode->pubTime().toTime_t());  // NOTE: We save the seconds since EPOC for easier handling.
-    q.bindValue(":duration", episode->duration());
-    q.bindValue(":downloadSize", episode->downloadSize());
-    q.bindValue(":id", episode->dbid());
-    q.bindValue(":lastPlayed", episode->lastPlayed().isValid() ? episode->lastPlayed().toTime_t() : 0);  // NOTE: We save the seconds since EPOC for easier handling.
-    q.bindValue(":hasBeenCanceled", episode->hasBeenCanceled());
+    foreach(QVariant update, updates) {
+        QVariantMap columns = update.toMap();
+        int id = columns.take("id").toInt();
 
-    if (!q.exec()) {
-        qDebug() << "Last query: " << q.lastQuery();
-        qDebug() << "Error: " << q.lastError();
-        return;
+        if (columns.contains("title") && m_searchIndexed) {
+            QSqlQuery titleQuery = statement("UPDATE episodes_search SET title = :title WHERE rowid = :id");
+            titleQuery.bindValue(":title", columns.value("title"));
+            titleQuery.bindValue(":id", id);
+            titleQuery.exec();
+        }
+        if (columns.contains("description")) {
+            QString description = columns.take("description").toString();
+            saveEpisodeDescription(id, description);
+
+            if (m_searchIndexed) {
+                QSqlQuery descriptionQuery = statement("UPDATE episodes_search SET description = :description WHERE rowid = :id");
+                descriptionQuery.bindValue(":description", PodcastEpisode::plainText(description));
+                descriptionQuery.bindValue(":id", id);
+                descriptionQuery.exec();
+            }
+        }
+        if (columns.isEmpty()) {
+            continue;
+        }
+
+        // The columns are in the same order for the same set of changed
+        // fields, so each set has one statement in the cache.
+        QStringList assignments;
+        foreach(QString column, columns.keys()) {
+            assignments << QString("%1=:%1").arg(column);
+        }
+
+        QSqlQuery q = statement("UPDATE episodes SET " + assignments.join(", ") + " WHERE id=:id");
+        for (QVariantMap::const_iterator column = columns.constBegin(); column != columns.constEnd(); ++column) {
+            q.bindValue(":" + column.key(), column.value());
+        }
+        q.bindValue(":id", id);
+
+        if (!q.exec()) {
+            qDebug() << "Last query: " << q.lastQuery();
+            qDebug() << "Error: " << q.lastError();
+        }
     }
 
-    qDebug() << "Updated episode:" << episode->dbid() << "last played:" << episode->lastPlayed();
+    if (!m_connection.commit()) {
+        qWarning() << "SQL error: " << m_connection.lastError().text();
+        m_connection.rollback();
+    }
 }
 
-void PodcastSQLManager::removeChannelFromDB(int channelId)
+void PodcastSQLWriter::removeChannelFromDB(int channelId)
 {
-    mutex.lock();
     QSqlQuery q(m_connection);
-    mutex.unlock();
 
     qDebug() << "Deleting all episodes from DB with channel: " << channelId;
 
-    q.prepare("DELETE FROM episodes WHERE episodes.channelId = :chanId");
+    q.prepare(DeleteChannelEpisodesQuery);
     q.bindValue(":chanId", channelId);
     if (!q.exec()) {
         qWarning() << "SQL error:" << q.lastError();
@@ -457,123 +1293,420 @@ void PodcastSQLManager::removeChannelFromDB(int channelId)
 
 }
 
-bool PodcastSQLManager::removePodcastFromDB(PodcastEpisode *episode)
+/**
+ * Deletes the episodes in one transaction. Their links are kept, so that
+ * the episodes are not added back by a refresh.
+ */
+bool PodcastSQLWriter::removePodcastsFromDB(QList<int> episodeIds)
 {
-    mutex.lock();
-    QSqlQuery q(m_connection);
-    mutex.unlock();
+    qDebug() << "Deleting" << episodeIds.size() << "episodes from DB.";
 
-    qDebug() << "Deleting episode from DB with id: " << episode->dbid();
+    QSqlQuery recordQuery = statement(DeletedEpisodeInsertQuery);
+    QSqlQuery deleteQuery = statement(EpisodeDeleteQuery);
 
-    q.prepare("DELETE FROM episodes WHERE episodes.id = :episodeId");
-    q.bindValue(":episodeId", episode->dbid());
-    if (!q.exec()) {
-        qWarning() << "SQL error:" << q.lastError();
-        qWarning() << "SQL query:" << q.lastQuery();
+    m_connection.transaction();
+
+    foreach(int episodeId, episodeIds) {
+        recordQuery.bindValue(":id", episodeId);
+        deleteQuery.bindValue(":id", episodeId);
+        if (!recordQuery.exec() || !deleteQuery.exec()) {
+            qWarning() << "SQL error:" << recordQuery.lastError() << deleteQuery.lastError();
+            m_connection.rollback();
+            return false;
+        }
+    }
+
+    if (!m_connection.commit()) {
+        qWarning() << "SQL error: " << m_connection.lastError().text();
+        m_connection.rollback();
         return false;
     }
 
     return true;
 }
 
-void PodcastSQLManager::createTables()
+int PodcastSQLWriter::schemaVersion()
 {
-    // If database does not contain table "channels", so create it.
-    if (!m_connection.tables().contains("channels")) {
-        QSqlQuery q(m_connection);
-        m_connection.transaction();
+    QSqlQuery q(m_connection);
+    if (!q.exec("PRAGMA user_version") || !q.next()) {
+        qWarning() << "SQL error: " << q.lastError().text();
+        return 0;
+    }
+
+    return q.value(0).toInt();
+}
 
-        qDebug() << "Creating table 'channels'";
+void PodcastSQLWriter::migrateSchema()
+{
+    int version = schemaVersion();
+    qDebug() << "DB schema version:" << version << ", current version:" << SchemaVersion;
 
-        q.exec("CREATE TABLE channels (id INTEGER PRIMARY KEY, "
-                                      "rssurl TEXT, "
-                                      "title TEXT, "
-                                      "description TEXT, "
-                                      "logo TEXT, "
-                                      "autoDownloadOn BOOLEAN)");
+    // Each step and its version bump is one transaction, so an interrupted
+    // migration is simply run again on the next start.
+    for (int nextVersion = version + 1; nextVersion <= SchemaVersion; nextVersion++) {
+        m_connection.transaction();
 
-        if (!m_connection.commit()) {
-            qDebug() << "SQL error: " << m_connection.lastError().text();
+        bool migrated = migrateSchemaTo(nextVersion);
+        if (migrated) {
+            QSqlQuery q(m_connection);
+            migrated = q.exec(QString("PRAGMA user_version = %1").arg(nextVersion));
         }
 
-        if (!q.isValid()) {
-            qDebug() << q.lastError().text();
+        if (!migrated || !m_connection.commit()) {
+            qWarning() << "Could not migrate DB to schema version" << nextVersion << ":" << m_connection.lastError().text();
+            m_connection.rollback();
+            return;
         }
 
+        qDebug() << "Migrated DB to schema version" << nextVersion;
     }
 
-    // If database does not contain the table "episodes", so crate it.
-    if (!m_connection.tables().contains("episodes")) {
+    // Moving and compressing the descriptions leaves most of the old file as
+    // free pages. VACUUM can not run in a transaction, so it is done once here.
+    if (version < 7) {
+        qDebug() << "Compacting the DB file.";
         QSqlQuery q(m_connection);
-        m_connection.transaction();
+        if (!q.exec("VACUUM")) {
+            qWarning() << "SQL error: " << q.lastError().text();
+        }
+    }
+}
 
-        qDebug() << "Creating table 'episodes'";
-
-        q.exec("CREATE TABLE episodes (id INTEGER PRIMARY KEY, "
-                                      "title TEXT, "
-                                      "channelid INTEGER, "
-                                      "downloadLink TEXT, "
-                                      "lastPlayed INTEGER, "
-                                      "playLocation TEXT, "
-                                      "description TEXT, "
-                                      "published INTEGER, "
-                                      "duration TEXT, "
-                                      "downloadSize INTEGER, "
-                                      "hasBeenCanceled BOOLEAN, "
-                                      "FOREIGN KEY(channelid) REFERENCES channels(id))");
-
-        if (!m_connection.commit()) {
-            qDebug() << "SQL error: " <<  m_connection.lastError().text();
+bool PodcastSQLWriter::migrateSchemaTo(int version)
+{
+    QStringList statements;
+
+    switch (version) {
+    case 6:
+        return createSearchIndex();
+
+    case 7:
+        return compressDescriptions();
+
+    case 1:
+        // The original tables. Databases from before the schema versions already have them.
+        statements << "CREATE TABLE IF NOT EXISTS channels (id INTEGER PRIMARY KEY, "
+                                                           "rssurl TEXT, "
+                                                           "title TEXT, "
+                                                           "description TEXT, "
+                                                           "logo TEXT)"
+                   << "CREATE TABLE IF NOT EXISTS episodes (id INTEGER PRIMARY KEY, "
+                                                           "title TEXT, "
+                                                           "channelid INTEGER, "
+                                                           "downloadLink TEXT, "
+                                                           "lastPlayed INTEGER, "
+                                                           "playLocation TEXT, "
+                                                           "description TEXT, "
+                                                           "published INTEGER, "
+                                                           "duration TEXT, "
+                                                           "downloadSize INTEGER, "
+                                                           "hasBeenCanceled BOOLEAN, "
+                                                           "FOREIGN KEY(channelid) REFERENCES channels(id))";
+        break;
+
+    case 2:
+        // Channels from before auto-downloads get the default from the settings, see checkAndCreateAutoDownload().
+        if (!hasColumn("channels", "autoDownloadOn")) {
+            statements << "ALTER TABLE channels ADD COLUMN autoDownloadOn BOOLEAN";
+            m_autoDownloadColumnAdded = true;
         }
+        break;
 
-        if (!q.isValid()) {
-            qDebug() << q.lastError().text();
+    case 3:
+        // Episodes are always read per channel, newest first. The partial index
+        // covers the unplayed downloads counted for every channel.
+        statements << "CREATE INDEX IF NOT EXISTS episodes_channel_published ON episodes(channelid, published DESC)"
+                   << "CREATE INDEX IF NOT EXISTS episodes_unplayed_downloads ON episodes(channelid) "
+                      "WHERE lastPlayed = 0 AND playLocation <> ''"
+                   << "CREATE INDEX IF NOT EXISTS channels_rssurl ON channels(rssurl)"
+                   << "CREATE INDEX IF NOT EXISTS channels_title ON channels(title)";
+        break;
+
+    case 4:
+        // Episode counters of each channel, kept exact by triggers. They
+        // count the same as PodcastEpisode::isUnplayed() and isDownloaded().
+        // The partial index was only needed to count the unplayed episodes.
+        statements << "ALTER TABLE channels ADD COLUMN unplayedEpisodes INTEGER NOT NULL DEFAULT 0"
+                   << "ALTER TABLE channels ADD COLUMN downloadedEpisodes INTEGER NOT NULL DEFAULT 0"
+                   << "ALTER TABLE channels ADD COLUMN totalEpisodes INTEGER NOT NULL DEFAULT 0"
+                   << "UPDATE channels SET "
+                      "unplayedEpisodes = (SELECT COUNT(id) FROM episodes WHERE episodes.channelid = channels.id AND episodes.lastPlayed = 0 AND episodes.playLocation <> ''), "
+                      "downloadedEpisodes = (SELECT COUNT(id) FROM episodes WHERE episodes.channelid = channels.id AND episodes.playLocation <> ''), "
+                      "totalEpisodes = (SELECT COUNT(id) FROM episodes WHERE episodes.channelid = channels.id)"
+                   << "CREATE TRIGGER IF NOT EXISTS episodes_counters_insert AFTER INSERT ON episodes BEGIN "
+                      "UPDATE channels SET unplayedEpisodes = unplayedEpisodes + IFNULL(NEW.lastPlayed = 0 AND NEW.playLocation <> '', 0), "
+                                          "downloadedEpisodes = downloadedEpisodes + IFNULL(NEW.playLocation <> '', 0), "
+                                          "totalEpisodes = totalEpisodes + 1 "
+                      "WHERE id = NEW.channelid; "
+                      "END"
+                   << "CREATE TRIGGER IF NOT EXISTS episodes_counters_delete AFTER DELETE ON episodes BEGIN "
+                      "UPDATE channels SET unplayedEpisodes = unplayedEpisodes - IFNULL(OLD.lastPlayed = 0 AND OLD.playLocation <> '', 0), "
+                                          "downloadedEpisodes = downloadedEpisodes - IFNULL(OLD.playLocation <> '', 0), "
+                                          "totalEpisodes = totalEpisodes - 1 "
+                      "WHERE id = OLD.channelid; "
+                      "END"
+                   << "CREATE TRIGGER IF NOT EXISTS episodes_counters_update AFTER UPDATE OF channelid, lastPlayed, playLocation ON episodes BEGIN "
+                      "UPDATE channels SET unplayedEpisodes = unplayedEpisodes - IFNULL(OLD.lastPlayed = 0 AND OLD.playLocation <> '', 0), "
+                                          "downloadedEpisodes = downloadedEpisodes - IFNULL(OLD.playLocation <> '', 0), "
+                                          "totalEpisodes = totalEpisodes - 1 "
+                      "WHERE id = OLD.channelid; "
+                      "UPDATE channels SET unplayedEpisodes = unplayedEpisodes + IFNULL(NEW.lastPlayed = 0 AND NEW.playLocation <> '', 0), "
+                                          "downloadedEpisodes = downloadedEpisodes + IFNULL(NEW.playLocation <> '', 0), "
+                                          "totalEpisodes = totalEpisodes + 1 "
+                      "WHERE id = NEW.channelid; "
+                      "END"
+                   << "DROP INDEX IF EXISTS episodes_unplayed_downloads";
+        break;
+
+    case 5:
+        // Descriptions move to a table of their own. The episodes table keeps
+        // a short plain text preview, filled in below. SQLite can not drop the
+        // old column, it is only emptied.
+        statements << "CREATE TABLE IF NOT EXISTS episode_descriptions (episodeid INTEGER PRIMARY KEY, "
+                                                                       "description TEXT, "
+                                                                       "FOREIGN KEY(episodeid) REFERENCES episodes(id))"
+                   << "ALTER TABLE episodes ADD COLUMN preview TEXT"
+                   << "INSERT OR REPLACE INTO episode_descriptions (episodeid, description) "
+                      "SELECT id, description FROM episodes WHERE description IS NOT NULL AND description <> ''"
+                   << "CREATE TRIGGER IF NOT EXISTS episodes_descriptions_delete AFTER DELETE ON episodes BEGIN "
+                      "DELETE FROM episode_descriptions WHERE episodeid = OLD.id; "
+                      "END";
+        break;
+
+    case 8:
+        // The episodes are paged by (published, id), newest first.
+        statements << "CREATE INDEX IF NOT EXISTS episodes_channel_published_id ON episodes(channelid, published, id)"
+                   << "DROP INDEX IF EXISTS episodes_channel_published";
+        break;
+
+    case 9:
+        // The newest episodes of all channels, for the inbox.
+        statements << "CREATE INDEX IF NOT EXISTS episodes_published_id ON episodes(published, id)";
+        break;
+
+    case 10:
+        // The links of the episodes deleted by the cleanup, so that a refresh
+        // does not add them back. They go with their channel.
+        statements << "CREATE TABLE IF NOT EXISTS deleted_episodes (channelid INTEGER, "
+                                                                   "downloadLink TEXT, "
+                                                                   "PRIMARY KEY(channelid, downloadLink))"
+                   << "CREATE TRIGGER IF NOT EXISTS channels_deleted_episodes_delete AFTER DELETE ON channels BEGIN "
+                      "DELETE FROM deleted_episodes WHERE channelid = OLD.id; "
+                      "END";
+        break;
+    }
+
+    QSqlQuery q(m_connection);
+    foreach(QString statement, statements) {
+        if (!q.exec(statement)) {
+            qWarning() << "SQL error: " << q.lastError().text();
+            qWarning() << "SQL query:" << q.lastQuery();
+            return false;
         }
     }
+
+    if (version == 5) {
+        return fillEpisodePreviews();
+    }
+
+    return true;
 }
 
-void PodcastSQLManager::checkAndCreateAutoDownload(bool autoDownload)
+/**
+ * The full text search index of the episodes, with the descriptions as plain
+ * text. Its rowid is the id of the episode. The index is only left out if
+ * SQLite has no FTS5, so that the rest of the app still works.
+ */
+bool PodcastSQLWriter::createSearchIndex()
 {
     QSqlQuery q(m_connection);
+    if (!q.exec("CREATE VIRTUAL TABLE IF NOT EXISTS episodes_search USING fts5(title, description, channel, "
+                                                                              "tokenize = 'unicode61 remove_diacritics 2', "
+                                                                              "prefix = '3')")) {
+        qWarning() << "Full text search is not available:" << q.lastError().text();
+        return true;
+    }
 
-    if (q.exec("SELECT autoDownloadOn FROM channels") == false) {
-        qDebug() << "SQL: channels does not contain 'autoDownloadOn'. Adding column.";
+    if (!q.exec("CREATE TRIGGER IF NOT EXISTS episodes_search_delete AFTER DELETE ON episodes BEGIN "
+                "DELETE FROM episodes_search WHERE rowid = OLD.id; "
+                "END")) {
+        qWarning() << "SQL error: " << q.lastError().text();
+        return false;
+    }
 
-        QSqlQuery q_create(m_connection);
+    QSqlQuery episodes(m_connection);
+    episodes.setForwardOnly(true);
+    if (!episodes.exec("SELECT episodes.id, episodes.title, episode_descriptions.description, channels.title FROM episodes "
+                       "LEFT JOIN episode_descriptions ON episode_descriptions.episodeid = episodes.id "
+                       "LEFT JOIN channels ON channels.id = episodes.channelid")) {
+        qWarning() << "SQL error: " << episodes.lastError().text();
+        return false;
+    }
 
-        // Column does not exist. Create it.
-        if (q_create.exec("ALTER TABLE channels ADD COLUMN autoDownloadOn BOOLEAN") == false) {
-            qDebug()   << "SQL error: " <<  q_create.lastError().text();
-            qWarning() << "SQL query:"  <<  q_create.lastQuery();
+    q.prepare("INSERT INTO episodes_search (rowid, title, description, channel) VALUES (:id, :title, :description, :channel)");
+    while (episodes.next()) {
+        q.bindValue(":id", episodes.value(0).toInt());
+        q.bindValue(":title", episodes.value(1).toString());
+        q.bindValue(":description", PodcastEpisode::plainText(episodes.value(2).toString()));
+        q.bindValue(":channel", episodes.value(3).toString());
+        if (!q.exec()) {
+            qWarning() << "SQL error: " << q.lastError().text();
+            return false;
         }
     }
 
-    // Find out if we have any results from the previous SELECT.
-    bool foundAutoDownloads = false;
-    while(q.next()) {
-        qDebug() << "SQL: Found autodownload values in DB. Not setting default ones.";
-        foundAutoDownloads = true;
-        break;
+    return true;
+}
+
+bool PodcastSQLWriter::compressDescriptions()
+{
+    QSqlQuery descriptions(m_connection);
+    descriptions.setForwardOnly(true);
+    if (!descriptions.exec("SELECT episodeid, description FROM episode_descriptions WHERE typeof(description) = 'text'")) {
+        qWarning() << "SQL error: " << descriptions.lastError().text();
+        return false;
     }
 
-    if (foundAutoDownloads == false) {
-        qDebug() << "SQL: No auto dowload values in DB. Setting defaults (from Settings).";
+    QSqlQuery q(m_connection);
+    q.prepare("UPDATE episode_descriptions SET description=:description WHERE episodeid=:id");
+    while (descriptions.next()) {
+        q.bindValue(":description", compressDescription(descriptions.value(1).toString()));
+        q.bindValue(":id", descriptions.value(0).toInt());
+        if (!q.exec()) {
+            qWarning() << "SQL error: " << q.lastError().text();
+            return false;
+        }
+    }
 
-        q.clear();
+    return true;
+}
 
-        q.prepare("UPDATE channels SET autoDownloadOn=:autoDownloadOn");
-        q.bindValue(":autoDownloadOn", autoDownload);
+bool PodcastSQLWriter::fillEpisodePreviews()
+{
+    QSqlQuery descriptions(m_connection);
+    descriptions.setForwardOnly(true);
+    if (!descriptions.exec("SELECT episodeid, description FROM episode_descriptions")) {
+        qWarning() << "SQL error: " << descriptions.lastError().text();
+        return false;
+    }
 
-        if (q.exec() == false) {
-            qDebug()   << "SQL error: " <<  q.lastError().text();
-            qWarning() << "SQL query:"  <<  q.lastQuery();
+    QSqlQuery q(m_connection);
+    q.prepare("UPDATE episodes SET preview=:preview WHERE id=:id");
+    while (descriptions.next()) {
+        q.bindValue(":preview", PodcastEpisode::descriptionPreview(descriptions.value(1).toString()));
+        q.bindValue(":id", descriptions.value(0).toInt());
+        if (!q.exec()) {
+            qWarning() << "SQL error: " << q.lastError().text();
+            return false;
         }
     }
 
+    if (!q.exec("UPDATE episodes SET description = NULL")) {
+        qWarning() << "SQL error: " << q.lastError().text();
+        return false;
+    }
 
+    return true;
 }
 
-void PodcastSQLManager::updateChannelAutoDownloadToDB(bool autoDownloadOn)
+bool PodcastSQLWriter::hasColumn(const QString &table, const QString &column)
+{
+    QSqlQuery q(m_connection);
+    if (!q.exec(QString("PRAGMA table_info(%1)").arg(table))) {
+        qWarning() << "SQL error: " << q.lastError().text();
+        return false;
+    }
+
+    while (q.next()) {
+        if (q.value(q.record().indexOf("name")).toString() == column) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Runs EXPLAIN QUERY PLAN for the hot queries and warns about every full
+ * table scan, i.e. a scan that does not use an index. Returns false if any
+ * of the queries scans a table.
+ */
+bool PodcastSQLManager::checkQueryPlans()
+{
+    QStringList hotQueries;
+    hotQueries << ChannelsQuery
+               << ChannelByIdQuery
+               << ChannelExistsQuery
+               << EpisodesQuery
+               << EpisodesAfterQuery
+               << LatestEpisodeQuery
+               << EpisodeLinksQuery
+               << OldEpisodesQuery
+               << EpisodeDescriptionQuery
+               << EpisodeSearchQuery
+               << NewestEpisodesQuery
+               << DeleteChannelEpisodesQuery;
+
+    bool noTableScans = true;
+
+    QSqlQuery q(readConnection());
+    foreach(QString query, hotQueries) {
+        q.prepare("EXPLAIN QUERY PLAN " + query);
+
+        // The values do not change the plan, but every placeholder needs one.
+        QStringList placeholders;
+        placeholders << ":id" << ":chanId" << ":url" << ":match" << ":limit" << ":published" << ":keep";
+        foreach(QString placeholder, placeholders) {
+            if (query.contains(placeholder)) {
+                q.bindValue(placeholder, 0);
+            }
+        }
+
+        if (!q.exec()) {
+            qWarning() << "SQL error: " << q.lastError().text();
+            qWarning() << "SQL query:" << query;
+            noTableScans = false;
+            continue;
+        }
+
+        while (q.next()) {
+            // "SCAN TABLE episodes" (or "SCAN episodes" in newer SQLite) without "USING ... INDEX".
+            // A "SCAN episodes_search VIRTUAL TABLE INDEX" is a lookup in the full text index.
+            QString detail = q.value(q.record().indexOf("detail")).toString();
+            if (detail.startsWith("SCAN") && !detail.contains("USING") && !detail.contains("VIRTUAL TABLE")) {
+                qWarning() << "Full table scan:" << detail << "in query:" << query;
+                noTableScans = false;
+            }
+        }
+    }
+
+    qDebug() << "Query plans checked. No full table scans:" << noTableScans;
+    return noTableScans;
+}
+
+void PodcastSQLWriter::checkAndCreateAutoDownload(bool autoDownload)
+{
+    // The column itself is added by the schema migration. Only give the
+    // existing channels the default value from the settings.
+    if (!m_autoDownloadColumnAdded) {
+        return;
+    }
+
+    qDebug() << "SQL: No auto dowload values in DB. Setting defaults (from Settings).";
+
+    QSqlQuery q(m_connection);
+    q.prepare("UPDATE channels SET autoDownloadOn=:autoDownloadOn");
+    q.bindValue(":autoDownloadOn", autoDownload);
+
+    if (q.exec() == false) {
+        qDebug()   << "SQL error: " <<  q.lastError().text();
+        qWarning() << "SQL query:"  <<  q.lastQuery();
+    }
+
+    m_autoDownloadColumnAdded = false;
+}
+
+void PodcastSQLWriter::updateChannelAutoDownloadToDB(bool autoDownloadOn)
 {
     QSqlQuery q(m_connection);
 
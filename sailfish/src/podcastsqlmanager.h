@@ -20,12 +20,47 @@
 
 #include <QObject>
 #include <QList>
-#include <QSqlDatabase>
+#include <QHash>
+#include <QMap>
 #include <QMutex>
+#include <QSet>
+#include <QTimer>
+#include <QVariant>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QThread>
+#include <QThreadStorage>
+#include <QVector>
 
 #include "podcastchannel.h"
 #include "podcastepisode.h"
 
+typedef QHash<PodcastChannel *, QList<PodcastEpisode *> > PodcastChannelEpisodes;
+
+// An episode in a list of episodes of all channels, like the ones of
+// PodcastSQLManager::searchEpisodesInDB() and newestEpisodesInDB().
+struct PodcastEpisodeSummary
+{
+    int episodeId;
+    int channelId;
+    QString title;
+    QString channelTitle;
+    QString preview;
+    QDateTime published;
+    QString publishedText;  // Filled in by the models that show it.
+};
+
+class PodcastSQLWriter;
+class PodcastSQLReaderConnection;
+
+/**
+ * The podcast database.
+ *
+ * The database is in WAL mode. All writes are run in one writer thread, on a
+ * connection of its own, one after the other. The caller waits for its write
+ * to be committed. Reads use a connection of the calling thread, so reading
+ * never waits for a write transaction to finish.
+ */
 class PodcastSQLManager : public QObject
 {
     Q_OBJECT
@@ -33,38 +68,112 @@ public:
     QList<PodcastChannel *> channelsInDB();
     PodcastChannel* channelInDB(int channelId, PodcastChannel *channel = 0);
 
-    QList<PodcastEpisode *> episodesInDB(int channelId);
+    QVector<PodcastEpisodeData> episodesInDB(int channelId, int limit, const PodcastEpisodeData *after = 0);
+    QString episodeDescriptionInDB(int episodeId);
+    QList<PodcastEpisodeSummary> searchEpisodesInDB(const QString &text, int limit);
+    QList<PodcastEpisodeSummary> newestEpisodesInDB(int limit);
 
     int podcastChannelToDB(PodcastChannel *channel);
     bool isChannelInDB(PodcastChannel *channel);
-    bool podcastEpisodeToDB(PodcastEpisode *episode,
-                            int channel_id);
     int podcastEpisodesToDB(QList<PodcastEpisode *> parsedEpisodes,
                             int channel_id);
-    bool removePodcastFromDB(PodcastEpisode *episode);
+    QList<PodcastChannel *> importChannelsToDB(const QList<PodcastChannel *> &channels,
+                                               const PodcastChannelEpisodes &episodes);
+    bool removePodcastsFromDB(const QList<PodcastEpisodeData> &episodes);
     bool updateChannelInDB(PodcastChannel *channel);
-    void updatePodcastInDB(PodcastEpisode *episode);
+    void updatePodcastInDB(PodcastEpisodeData &episode);
     QDateTime latestEpisodeTimestampInDB(int channelId);
+    QSet<QString> episodeLinksInDB(int channelId);
+    QList<PodcastEpisodeData> oldEpisodesInDB(int channelId, int keepNumEpisodes, bool keepUnplayed);
     void removeChannelFromDB(int channelId);
     void updateChannelAutoDownloadToDB(bool autoDownloadOn);
     void checkAndCreateAutoDownload(bool autoDownloadOn);
+    bool checkQueryPlans();
+    void setStatementCaching(bool enabled);
 
 signals:
+    /**
+     * The unplayed, downloaded and total episodes of the channel changed
+     * by the given amounts.
+     */
+    void episodeCountersChanged(int channelId, int unplayedDelta, int downloadedDelta, int totalDelta);
+    void episodesRemoved(const QList<int> &episodeIds);
 
 public slots:
 
+private slots:
+    void onAboutToQuit();
+    void onEpisodeUpdateTimeout();
+
 private:
     PodcastSQLManager(QObject *parent = 0);
-    void createTables();
+    QSqlDatabase readConnection();
+    QSqlQuery readStatement(const QString &query);
+    static QList<PodcastEpisodeSummary> episodeSummaries(QSqlQuery &q);
+    Qt::ConnectionType writerConnectionType() const;
+    void updateEpisodeCounters(int channelId, int unplayedDelta, int downloadedDelta, int totalDelta);
+    void flushEpisodeUpdates(bool wait);
 
-    QSqlDatabase m_connection;
     friend class PodcastSQLManagerFactory;
 
     // Disable instatiation.
     PodcastSQLManager(PodcastSQLManager const&);              // Don't Implement
     void operator=(PodcastSQLManager const&);                 // Don't implement
 
-    QMutex mutex;
+    QString m_databaseFile;
+    QThread m_writerThread;
+    PodcastSQLWriter *m_writer;
+    QThreadStorage<PodcastSQLReaderConnection *> m_readerConnections;
+
+    // Changed columns of episodes, by episode id, waiting to be written.
+    QMap<int, QVariantMap> m_episodeUpdates;
+    QMutex m_episodeUpdatesMutex;
+    QTimer m_episodeUpdateTimer;
+};
+
+/**
+ * Runs the writes of PodcastSQLManager. Lives in the writer thread and owns
+ * the only connection that writes to the database.
+ */
+class PodcastSQLWriter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PodcastSQLWriter(QObject *parent = 0);
+
+    Q_INVOKABLE bool open(const QString &databaseFile);
+    Q_INVOKABLE void close();
+
+    Q_INVOKABLE int podcastChannelToDB(PodcastChannel *channel);
+    Q_INVOKABLE int podcastEpisodesToDB(QList<PodcastEpisode *> parsedEpisodes, int channelid);
+    Q_INVOKABLE QList<PodcastChannel *> importChannelsToDB(QList<PodcastChannel *> channels,
+                                                           PodcastChannelEpisodes episodes);
+    Q_INVOKABLE bool removePodcastsFromDB(QList<int> episodeIds);
+    Q_INVOKABLE bool updateChannelInDB(PodcastChannel *channel);
+    Q_INVOKABLE void updateEpisodesInDB(QVariantList updates);
+    Q_INVOKABLE void removeChannelFromDB(int channelId);
+    Q_INVOKABLE void updateChannelAutoDownloadToDB(bool autoDownloadOn);
+    Q_INVOKABLE void checkAndCreateAutoDownload(bool autoDownloadOn);
+    Q_INVOKABLE void setStatementCaching(bool enabled);
+
+private:
+    QSqlQuery statement(const QString &query);
+    bool insertEpisode(QSqlQuery &q, PodcastEpisode *episode, int channelid);
+    bool saveEpisodeDescription(int episodeId, const QString &description);
+    void indexEpisode(int episodeId, int channelId, const QString &title, const QString &description);
+    bool fillEpisodePreviews();
+    bool createSearchIndex();
+    bool compressDescriptions();
+    int schemaVersion();
+    void migrateSchema();
+    bool migrateSchemaTo(int version);
+    bool hasColumn(const QString &table, const QString &column);
+
+    QSqlDatabase m_connection;
+    QHash<QString, QSqlQuery> m_statements;
+    bool m_statementCaching;
+    bool m_autoDownloadColumnAdded;
+    bool m_searchIndexed;
 };
 
 class PodcastSQLManagerFactory
@@ -19,10 +19,14 @@
 #define PODCASTTESTER_H
 
 #include <QObject>
+#include <QDateTime>
+#include <QElapsedTimer>
 #include <QtDebug>
 
 #include "podcastchannel.h"
 #include "podcastmanager.h"
+#include "podcastcontentdecoder.h"
+#include "podcastsqlmanager.h"
 
 class PodcastTester {
 public:
@@ -34,7 +38,7 @@ public:
         qDebug() << "  Testing channels!";
         podcastManager.requestPodcastChannel(QUrl("http://leoville.tv/podcasts/kfi.xml"));
 
-        QList<PodcastChannel *> channels = podcastManager.podcastChannels();
+        QList<PodcastChannel *> channels = podcastManager.podcastChannelsModel()->channels();
         foreach(PodcastChannel *chan, channels) {
             qDebug() <<  chan->channelDbId() << chan->title() << chan->logo();
         }
@@ -48,7 +52,160 @@ public:
         podcastManager.refreshPodcastChannelEpisodes(&channel);
     }
 
+    bool testContentDecoding() {
+        qDebug() << "  Testing content decoding!";
+
+        QByteArray feed;
+        for (int i=0; i<1000; i++) {
+            feed.append("<item><title>Episode</title><enclosure url=\"http://example.org/episode.mp3\"/></item>");
+        }
+
+        // qCompress() prepends the uncompressed size to a zlib stream.
+        QByteArray deflated = qCompress(feed).mid(4);
+
+        // Feed the decoder in small chunks, like the network does.
+        PodcastContentDecoder decoder("deflate");
+        QByteArray decoded;
+        for (int i=0; i<deflated.size(); i+=7) {
+            decoder.decode(deflated.mid(i, 7), &decoded);
+        }
+
+        bool deflateOk = decoder.finish() && decoded == feed;
+        qDebug() << "    Accept-Encoding:" << PodcastContentDecoder::acceptEncoding();
+        qDebug() << "    Deflate:" << (deflateOk ? "OK" : "FAILED")
+                 << deflated.size() << "->" << decoded.size() << "bytes";
+
+        PodcastContentDecoder truncatedDecoder("deflate");
+        truncatedDecoder.decode(deflated.left(deflated.size() / 2), &decoded);
+        bool truncatedOk = !truncatedDecoder.finish();
+        qDebug() << "    Truncated:" << (truncatedOk ? "OK" : "FAILED");
+
+        return deflateOk && truncatedOk;
+    }
+
+    bool testQueryPlans() {
+        qDebug() << "  Testing query plans!";
+
+        PodcastSQLManager *sqlManager = PodcastSQLManagerFactory::sqlmanager();
+        bool noTableScans = sqlManager->checkQueryPlans();
+        qDebug() << "    No full table scans:" << (noTableScans ? "OK" : "FAILED");
+        return noTableScans;
+    }
+
+    void benchmarkSearch() {
+        qDebug() << "  Benchmarking library search!";
+
+        PodcastSQLManager *sqlManager = PodcastSQLManagerFactory::sqlmanager();
+        QStringList searchTexts;
+        searchTexts << "a" << "new" << "interview" << "the news";
+        foreach(QString searchText, searchTexts) {
+            QElapsedTimer timer;
+            timer.start();
+            QList<PodcastEpisodeSummary> results = sqlManager->searchEpisodesInDB(searchText, 100);
+            qDebug() << "    Search" << searchText << ":" << results.size() << "episodes in" << timer.elapsed() << "ms";
+        }
+    }
+
+    /**
+     * Times the statements of PodcastSQLManager. The same 5000 episodes are
+     * saved once with a prepare() for every statement and once with the
+     * cached statements, each to a channel of its own, which is removed after.
+     */
+    void benchmarkEpisodeInserts() {
+        qDebug() << "  Benchmarking episode inserts!";
+
+        PodcastSQLManager *sqlManager = PodcastSQLManagerFactory::sqlmanager();
+
+        int uncachedChannelId = benchmarkChannel("uncached");
+        int channelId = benchmarkChannel("cached");
+        if (uncachedChannelId < 1 || channelId < 1) {
+            qWarning() << "    Could not save the benchmark channels.";
+            return;
+        }
+
+        sqlManager->setStatementCaching(false);
+        qint64 uncachedRate = benchmarkIngest(uncachedChannelId);
+        sqlManager->setStatementCaching(true);
+        qint64 cachedRate = benchmarkIngest(channelId);
+
+        // Reads: every refresh asks for the newest episode, and the list is paged through.
+        QElapsedTimer timer;
+        timer.start();
+        for (int i=0; i<NumRefreshes; i++) {
+            sqlManager->latestEpisodeTimestampInDB(channelId);
+        }
+        qint64 latestTime = qMax(qint64(1), timer.elapsed());
+
+        timer.restart();
+        int pages = 0;
+        int read = 0;
+        QVector<PodcastEpisodeData> page = sqlManager->episodesInDB(channelId, 30);
+        while (!page.isEmpty()) {
+            pages++;
+            read += page.size();
+            PodcastEpisodeData last = page.last();
+            page = sqlManager->episodesInDB(channelId, 30, &last);
+        }
+        qint64 pageTime = qMax(qint64(1), timer.elapsed());
+
+        qDebug() << "    podcastEpisodesToDB, prepared per call:" << uncachedRate << "inserts/s";
+        qDebug() << "    podcastEpisodesToDB, cached statements:" << cachedRate << "inserts/s";
+        qDebug() << "    latestEpisodeTimestampInDB:" << NumRefreshes * 1000 / latestTime << "queries/s";
+        qDebug() << "    episodesInDB:" << read << "episodes in" << pages << "pages,"
+                 << pages * 1000 / pageTime << "pages/s";
+
+        sqlManager->removeChannelFromDB(uncachedChannelId);
+        sqlManager->removeChannelFromDB(channelId);
+    }
+
 private:
+    static const int NumRefreshes = 500;
+    static const int EpisodesPerRefresh = 10;
+
+    static int benchmarkChannel(const QString &name) {
+        PodcastChannel channel;
+        channel.setUrl(QString("http://example.org/podcatcher-benchmark-%1.xml").arg(name));
+        channel.setTitle(QString("Podcatcher benchmark (%1)").arg(name));
+        PodcastSQLManagerFactory::sqlmanager()->podcastChannelToDB(&channel);
+        return channel.channelDbId();
+    }
+
+    /**
+     * Saves the episodes like refreshes of a feed do, the new episodes of
+     * each refresh in one call. Returns the inserts per second.
+     */
+    static qint64 benchmarkIngest(int channelId) {
+        PodcastSQLManager *sqlManager = PodcastSQLManagerFactory::sqlmanager();
+
+        QElapsedTimer timer;
+        timer.start();
+        int saved = 0;
+        for (int i=0; i<NumRefreshes; i++) {
+            QList<PodcastEpisode *> episodes;
+            for (int j=0; j<EpisodesPerRefresh; j++) {
+                episodes << benchmarkEpisode(i * EpisodesPerRefresh + j);
+            }
+            sqlManager->podcastEpisodesToDB(episodes, channelId);
+            foreach(PodcastEpisode *episode, episodes) {
+                saved += (episode->dbid() > 0);
+            }
+            qDeleteAll(episodes);
+        }
+
+        return saved * 1000 / qMax(qint64(1), timer.elapsed());
+    }
+
+    static PodcastEpisode * benchmarkEpisode(int i) {
+        PodcastEpisode *episode = new PodcastEpisode;
+        episode->setTitle(QString("Episode %1").arg(i));
+        episode->setDownloadLink(QString("http://example.org/podcatcher-benchmark/episode%1.mp3").arg(i));
+        episode->setDescription(QString("An episode description of some length. ").repeated(10));
+        episode->setPubTime(QDateTime::fromTime_t(1400000000 + i));
+        episode->setDuration("01:00:00");
+        episode->setDownloadSize(50000000);
+        return episode;
+    }
+
     PodcastManager podcastManager;
 };
 
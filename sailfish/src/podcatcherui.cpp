@@ -26,13 +26,22 @@
 #include "podcastepisodesmodel.h"
 #include "podcastepisodesmodelfactory.h"
 #include "podcastglobals.h"
+#include "podcastimageprovider.h"
 
-PodcatcherUI::PodcatcherUI()
+PodcatcherUI::PodcatcherUI() :
+    m_shownChannelId(0)
 {
     view = SailfishApp::createView();
     m_channelsModel = m_pManager.podcastChannelsModel();
+    m_searchModel = new PodcastSearchModel(this);
+    m_inboxModel = new PodcastInboxModel(m_channelsModel, this);
+    m_episodesFilterModel = new PodcastEpisodesFilterModel(this);
     view->rootContext()->setContextProperty("channelsModel", m_channelsModel);
+    view->rootContext()->setContextProperty("inboxModel", m_inboxModel);
+    view->rootContext()->setContextProperty("searchModel", m_searchModel);
+    view->rootContext()->setContextProperty("episodesFilterModel", m_episodesFilterModel);
     view->rootContext()->setContextProperty("ui", this);
+    view->engine()->addImageProvider("podcatcher", new PodcastImageProvider);
 
     view->setSource(SailfishApp::pathTo("qml/Podcatcher.qml"));
 
@@ -48,12 +57,19 @@ PodcatcherUI::PodcatcherUI()
     connect(&m_pManager, SIGNAL(showInfoBanner(QString)),
             this, SIGNAL(showInfoBanner(QString)));
 
+    // Imported channels come with their episodes, not through a refresh.
+    connect(&m_pManager, SIGNAL(podcastChannelSaved()),
+            m_inboxModel, SLOT(reload()));
+
     connect(&m_pManager, SIGNAL(downloadingPodcasts(bool)),
             this, SIGNAL(downloadingPodcasts(bool)));
 
     connect(&m_pManager, SIGNAL(downloadingPodcasts(bool)),
             this, SLOT(onDownloadingPodcast(bool)));
 
+    connect(&m_pManager, SIGNAL(importProgress(int, int)),
+            this, SIGNAL(importProgress(int, int)));
+
     QObject *rootDeclarativeItem = view->rootObject();
 
     connect(rootDeclarativeItem, SIGNAL(showChannel(QString)),
@@ -139,19 +155,35 @@ void PodcatcherUI::onShowChannel(QString channelId)
 
     view->rootContext()->setContextProperty("channel", channel);
 
+    // The model in the view stays in the cache of the factory while it is shown.
+    modelFactory->pinModel(channel->channelDbId());
+    if (m_shownChannelId > 0) {
+        modelFactory->unpinModel(m_shownChannelId);
+    }
+    m_shownChannelId = channel->channelDbId();
+
     PodcastEpisodesModel *episodesModel = modelFactory->episodesModel(channel->channelDbId());   // FIXME: Do not expose DB id.
     view->rootContext()->setContextProperty("episodesModel", episodesModel);
+
+    // A new page is opened for the channel, with all episodes shown.
+    m_episodesFilterModel->setFilter(PodcastEpisodesFilterModel::AllEpisodes);
+    m_episodesFilterModel->setSearchText(QString());
+    m_episodesFilterModel->setEpisodesModel(episodesModel);
 }
 
 
-void PodcatcherUI::onDownloadPodcast(int channelId, int index)
+void PodcatcherUI::onDownloadPodcast(int channelId, int dbid)
 {
     PodcastEpisodesModel *episodesModel = modelFactory->episodesModel(channelId);
-    PodcastEpisode *episode = episodesModel->episode(index);
+    PodcastEpisode *episode = episodesModel->episodeController(dbid);
+    if (episode == 0) {
+        qWarning() << "No episode with id" << dbid << "in channel" << channelId;
+        return;
+    }
     m_pManager.downloadPodcast(episode);
 }
 
-void PodcatcherUI::onPlayPodcast(int channelId, int index)
+void PodcatcherUI::onPlayPodcast(int channelId, int dbid)
 {
     PodcastEpisodesModel *episodesModel = modelFactory->episodesModel(channelId);
     if (episodesModel == 0) {
@@ -159,27 +191,26 @@ void PodcatcherUI::onPlayPodcast(int channelId, int index)
         return;
     }
 
-    PodcastEpisode *episode = episodesModel->episode(index);
+    const PodcastEpisodeData *episode = episodesModel->episodeByDbId(dbid);
+    if (episode == 0) {
+        qWarning() << "No episode with id" << dbid << "in channel" << channelId;
+        return;
+    }
 
-    QUrl file = QUrl::fromLocalFile(episode->playFilename());
+    QUrl file = QUrl::fromLocalFile(episode->playFilename);
 
     // If the file doens't exist, update the state in the DB
     // and do nothing more.
     QFile checkFile(file.toLocalFile());
     if (!checkFile.exists()) {
         qDebug() << "Original file " << file.toLocalFile() << " doesn't exist anymore.";
-        episode->setPlayFilename("");
-        episode->setState(PodcastEpisode::GetState);
-        episode->setLastPlayed(QDateTime());
-        episodesModel->refreshEpisode(episode);
+        episodesModel->forgetDownload(dbid);
 
         emit showInfoBanner(tr("Podcast episode not found."));
         return;
     }
 
-    episode->setLastPlayed(QDateTime::currentDateTime());
-    episodesModel->refreshEpisode(episode);
-    m_channelsModel->refreshChannel(channelId);
+    episodesModel->setPlayed(dbid, true);
 
     qDebug() << "Launching the music player for file" << file.fileName();
 
@@ -220,11 +251,15 @@ void PodcatcherUI::onRefreshEpisodes(int channelId)
     m_pManager.refreshPodcastChannelEpisodes(channel, true);
 }
 
-void PodcatcherUI::onCancelQueueing(int channelId, int index)
+void PodcatcherUI::onCancelQueueing(int channelId, int dbid)
 {
-    qDebug() << "Cancel queueing at " << channelId << index;
+    qDebug() << "Cancel queueing at " << channelId << dbid;
     PodcastEpisodesModel *episodesModel = modelFactory->episodesModel(channelId);
-    PodcastEpisode *episode = episodesModel->episode(index);
+    PodcastEpisode *episode = episodesModel->episodeController(dbid);
+    if (episode == 0) {
+        qWarning() << "No episode with id" << dbid << "in channel" << channelId;
+        return;
+    }
     episode->setState(PodcastEpisode::GetState);
 
     m_pManager.cancelQueueingPodcast(episode);
@@ -232,10 +267,14 @@ void PodcatcherUI::onCancelQueueing(int channelId, int index)
     episodesModel->refreshEpisode(episode);
 }
 
-void PodcatcherUI::onCancelDownload(int channelId, int index)
+void PodcatcherUI::onCancelDownload(int channelId, int dbid)
 {
     PodcastEpisodesModel *episodesModel = modelFactory->episodesModel(channelId);
-    PodcastEpisode *episode = episodesModel->episode(index);
+    PodcastEpisode *episode = episodesModel->episodeController(dbid);
+    if (episode == 0) {
+        qWarning() << "No episode with id" << dbid << "in channel" << channelId;
+        return;
+    }
     m_pManager.cancelDownloadPodcast(episode);
     episodesModel->refreshEpisode(episode);
 }
@@ -244,6 +283,7 @@ void PodcatcherUI::onDeleteChannel(QString channelId)
 {
     qDebug() << "Yep, lets delete the channel and some episodes from channel" << channelId;
     m_pManager.removePodcastChannel(channelId.toInt());
+    m_inboxModel->removeChannelEpisodes(channelId.toInt());
 
 }
 
@@ -252,49 +292,49 @@ void PodcatcherUI::onAllListened(QString channelId)
     qDebug() << "Yep, mark all listened on channel: " << channelId;
 
     PodcastEpisodesModel *episodesModel = modelFactory->episodesModel(channelId.toInt());
-    QList<PodcastEpisode *> unplayed = episodesModel->unplayedEpisodes();
-    foreach(PodcastEpisode *episode, unplayed) {
-        episode->setAsPlayed();
-        episodesModel->refreshEpisode(episode);
-    }
-
-    m_channelsModel->refreshChannel(channelId.toInt());
+    episodesModel->markAllAsPlayed();
 }
 
-void PodcatcherUI::onDeletePodcast(int channelId, int index)
+void PodcatcherUI::onDeletePodcast(int channelId, int dbid)
 {
-    qDebug() << "Deleting the locally downloaded podcast:" << channelId << index;
+    qDebug() << "Deleting the locally downloaded podcast:" << channelId << dbid;
 
     PodcastEpisodesModel *episodesModel = modelFactory->episodesModel(channelId);
-    PodcastEpisode *episode = episodesModel->episode(index);
-    qDebug() << "Episode name:" << episode->title() << episode->playFilename();
-    episode->deleteDownload();
-    episodesModel->refreshEpisode(episode);
-
-    m_channelsModel->refreshChannel(channelId);
+    const PodcastEpisodeData *episode = episodesModel->episodeByDbId(dbid);
+    if (episode == 0) {
+        qWarning() << "No episode with id" << dbid << "in channel" << channelId;
+        return;
+    }
+    qDebug() << "Episode name:" << episode->title << episode->playFilename;
+    episodesModel->deleteDownload(dbid);
 }
 
-void PodcatcherUI::onMarkAsUnplayed(int channelId, int index)
+void PodcatcherUI::onMarkAsUnplayed(int channelId, int dbid)
 {
     PodcastEpisodesModel *episodesModel = modelFactory->episodesModel(channelId);
-    PodcastEpisode *episode = episodesModel->episode(index);
+    if (episodesModel->episodeByDbId(dbid) == 0) {
+        qWarning() << "No episode with id" << dbid << "in channel" << channelId;
+        return;
+    }
 
-    episode->setAsUnplayed();
-    m_channelsModel->refreshChannel(channelId);
+    episodesModel->setPlayed(dbid, false);
 }
 
 void PodcatcherUI::deletePodcasts(int channelId)
 {
     m_pManager.deleteAllDownloadedPodcasts(channelId);
-    m_channelsModel->refreshChannel(channelId);
 }
 
-void PodcatcherUI::onStartStreaming(int channelId, int index)
+void PodcatcherUI::onStartStreaming(int channelId, int dbid)
 {
-    qDebug() << "Requested streaming of epsiode:" << channelId << index;
+    qDebug() << "Requested streaming of epsiode:" << channelId << dbid;
 
     PodcastEpisodesModel *episodesModel = modelFactory->episodesModel(channelId);
-    PodcastEpisode *episode = episodesModel->episode(index);
+    PodcastEpisode *episode = episodesModel->episodeController(dbid);
+    if (episode == 0) {
+        qWarning() << "No episode with id" << dbid << "in channel" << channelId;
+        return;
+    }
 
     connect(episode, SIGNAL(streamingUrlResolved(QString, QString)),
             this, SLOT(onStreamingUrlResolved(QString, QString)));
@@ -333,6 +373,27 @@ void PodcatcherUI::importFromGPodder(QString username, QString password)
     m_pManager.fetchSubscriptionsFromGPodder(username, password);
 }
 
+void PodcatcherUI::setChannelLogoSizes(QVariantList sizes)
+{
+    QList<int> logoSizes;
+    foreach(QVariant size, sizes) {
+        logoSizes << size.toInt();
+    }
+
+    m_pManager.setChannelLogoSizes(logoSizes);
+}
+
+void PodcatcherUI::importFromOPML(QString opmlFile)
+{
+    // The file can be given as a path or as a file:// URL.
+    QUrl opmlUrl(opmlFile);
+    if (opmlUrl.isLocalFile()) {
+        opmlFile = opmlUrl.toLocalFile();
+    }
+
+    m_pManager.importSubscriptionsFromOPML(opmlFile);
+}
+
 bool PodcatcherUI::isLiteVersion()
 {
 #ifdef LITE
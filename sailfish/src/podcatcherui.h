@@ -27,6 +27,9 @@
 
 #include "podcastmanager.h"
 #include "podcastchannelsmodel.h"
+#include "podcastepisodesfiltermodel.h"
+#include "podcastinboxmodel.h"
+#include "podcastsearchmodel.h"
 
 class PodcatcherUI : QObject
 {
@@ -41,6 +44,8 @@ public:
     Q_INVOKABLE void refreshChannels();
     Q_INVOKABLE QString versionString();
     Q_INVOKABLE void importFromGPodder(QString username, QString password);
+    Q_INVOKABLE void importFromOPML(QString opmlFile);
+    Q_INVOKABLE void setChannelLogoSizes(QVariantList sizes);
 
     Q_PROPERTY(bool isDownloading READ isDownloading NOTIFY isDownloadingChanged)
 
@@ -51,6 +56,7 @@ signals:
     void downloadedBytesUpdated(int bytes);
     void downloadingPodcasts(bool downloading);
     void streamingUrlResolved(QString streamUrl, QString streamTitle);
+    void importProgress(int done, int total);
 
     void isDownloadingChanged(bool isDownloading);
 
@@ -59,16 +65,16 @@ public slots:
 private slots:
     void onShowChannel(QString channelId);
     void onRefreshEpisodes(int channelId);
-    void onDownloadPodcast(int channelId, int index);
-    void onPlayPodcast(int channelId, int index);
+    void onDownloadPodcast(int channelId, int dbid);
+    void onPlayPodcast(int channelId, int dbid);
     void onDownloadingPodcast(bool isDownloading);
-    void onCancelDownload(int channelId, int index);
-    void onCancelQueueing(int channelId, int index);
+    void onCancelDownload(int channelId, int dbid);
+    void onCancelQueueing(int channelId, int dbid);
     void onDeleteChannel(QString channelId);
     void onAllListened(QString channelId);
-    void onDeletePodcast(int channelId, int index);
-    void onMarkAsUnplayed(int channelId, int index);
-    void onStartStreaming(int channelId, int index);
+    void onDeletePodcast(int channelId, int dbid);
+    void onMarkAsUnplayed(int channelId, int dbid);
+    void onStartStreaming(int channelId, int dbid);
     void onStreamingUrlResolved(QString streamUrl, QString streamTitle);
     void onAutoDownloadChanged(int channelId, bool autoDownload);
     void onMediaPlayerChanged();
@@ -77,7 +83,11 @@ private slots:
 private:
     PodcastManager m_pManager;
     PodcastChannelsModel *m_channelsModel;
+    PodcastSearchModel *m_searchModel;
+    PodcastInboxModel *m_inboxModel;
+    PodcastEpisodesFilterModel *m_episodesFilterModel;
     PodcastEpisodesModelFactory *modelFactory;
+    int m_shownChannelId;       // The channel whose episodes model is in the view.
     QMap<QString, QString> logoCache;
     QQuickView* view;
 